@@ -16,6 +16,12 @@ class NewtonSim {
     NewtonSim(const std::string &config_file, const std::string &output_dir);
     ~NewtonSim();
     void ClockTick();
+    // ClockTick() calls until a response can enter a response queue, max: nothing in flight
+    uint64_t TicksToNextResponse() const;
+    // tick channels on num_threads threads, results are identical for any count
+    void SetTickThreads(int num_threads);
+    // redirect stat files written from now on, used by forked continuations
+    void SetOutputDir(const std::string &output_dir);
     void RegisterCallbacks() { return; }
     double GetTCK() const;
     int GetBusBits() const;
@@ -63,6 +63,12 @@ NewtonSim::~NewtonSim() {
 
 void NewtonSim::ClockTick() { dram_system_->ClockTick(); }
 
+uint64_t NewtonSim::TicksToNextResponse() const { return dram_system_->TicksToNextDone(); }
+
+void NewtonSim::SetTickThreads(int num_threads) { dram_system_->SetTickThreads(num_threads); }
+
+void NewtonSim::SetOutputDir(const std::string &output_dir) { config_->SetOutputDir(output_dir); }
+
 double NewtonSim::GetTCK() const { return config_->tCK; }
 
 int NewtonSim::GetBusBits() const { return config_->bus_width; }
@@ -203,6 +203,18 @@ void Config::InitOtherParams() {
     // give a prefix instead of specify the output name one by one...
     // this would allow outputing to a directory and you can always override
     // these values
+    SetOutputNames(reader.Get("other", "output_prefix", "dramsim3"));
+    return;
+}
+
+void Config::SetOutputDir(const std::string &out_dir) {
+    // keep the file prefix from the ini file, only the directory changes
+    std::string file_prefix = output_prefix.substr(output_dir.size());
+    output_dir = out_dir;
+    SetOutputNames(file_prefix);
+}
+
+void Config::SetOutputNames(const std::string &file_prefix) {
     if (!DirExist(output_dir)) {
         std::cout << "WARNING: Output directory " << output_dir
                   << " not exists! Using current directory for output!" << std::endl;
@@ -210,11 +222,10 @@ void Config::InitOtherParams() {
     } else {
         output_dir = output_dir + "/";
     }
-    output_prefix = output_dir + reader.Get("other", "output_prefix", "dramsim3");
+    output_prefix = output_dir + file_prefix;
     json_stats_name = output_prefix + ".json";
     json_epoch_name = output_prefix + "epoch.json";
     txt_stats_name = output_prefix + ".txt";
-    return;
 }
 
 void Config::InitPowerParams() {
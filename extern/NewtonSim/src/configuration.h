@@ -38,6 +38,7 @@ class Config {
     Address AddressMapping(uint64_t hex_addr) const;
     uint64_t MakeAddress(int channel, int rank, int bankgroup, int bank, int row, int col);
     uint64_t EncodePIMHeader(int channel, int row, bool for_gwrite, int num_comps, int num_readres);
+    void SetOutputDir(const std::string &out_dir);
     // DRAM physical structure
     DRAMProtocol protocol;
     MemoryType memory_type;
@@ -183,6 +184,7 @@ class Config {
     void InitSystemParams();
     void InitTimingParams();
     void SetAddressMapping();
+    void SetOutputNames(const std::string &file_prefix);
 };
 
 } // namespace dramsim3
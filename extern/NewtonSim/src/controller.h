@@ -27,6 +27,8 @@ class Controller {
     virtual void PrintFinalStats() = 0;
     virtual void ResetStats() = 0;
     virtual std::pair<uint64_t, TransactionType> ReturnDoneTrans(uint64_t clock) = 0;
+    // earliest clock at which ReturnDoneTrans may return a transaction, max: nothing in flight
+    virtual uint64_t NextDoneCycle() const = 0;
     virtual void ResetPIMCycle() = 0;
     virtual uint64_t GetPIMCycle() = 0;
 };
@@ -37,6 +37,14 @@ DRAMController::DRAMController(int channel, const Config &config, const Timing &
 #endif  // CMD_TRACE
 }
 
+uint64_t DRAMController::NextDoneCycle() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (auto &trans : return_queue_) next = std::min(next, trans.complete_cycle);
+    // queued reads return read_delay after their command is issued, at the earliest now
+    if (!pending_rd_q_.empty()) next = std::min<uint64_t>(next, clk_ + config_.read_delay);
+    return next;
+}
+
 std::pair<uint64_t, TransactionType> DRAMController::ReturnDoneTrans(uint64_t clk) {
     auto it = return_queue_.begin();
     while (it != return_queue_.end()) {
@@ -2,6 +2,9 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace dramsim3 {
 
 // alternative way is to assign the id in constructor but this is less
@@ -12,7 +15,8 @@ BaseDRAMSystem::BaseDRAMSystem(Config &config, const std::string &output_dir,
                                std::function<void(uint64_t)> read_callback,
                                std::function<void(uint64_t)> write_callback)
     : read_callback_(read_callback), write_callback_(write_callback), last_req_clk_(0),
-      config_(config), timing_(config_), clk_(0) {
+      config_(config), timing_(config_), clk_(0), tick_threads_(1), tick_epoch_(0),
+      tick_pending_(0), tick_stop_(false) {
     total_channels_ += config_.channels;
 
 #ifdef ADDR_TRACE
@@ -26,6 +30,81 @@ int BaseDRAMSystem::GetChannel(uint64_t hex_addr) const {
     return (hex_addr >> config_.ch_pos) & config_.ch_mask;
 }
 
+void BaseDRAMSystem::SetTickThreads(int num_threads) {
+    StopTickWorkers();
+    // more tick threads than cores only adds barrier wake-ups to every tick
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores > 0)
+        num_threads = std::min(num_threads, cores);
+    tick_threads_ = std::max(1, std::min(num_threads, static_cast<int>(ctrls_.size())));
+    uint64_t epoch = tick_epoch_.load(std::memory_order_relaxed);
+    for (int worker_id = 1; worker_id < tick_threads_; worker_id++) {
+        tick_workers_.emplace_back(&BaseDRAMSystem::TickWorker, this, worker_id, epoch);
+    }
+}
+
+void BaseDRAMSystem::StopTickWorkers() {
+    if (tick_workers_.empty())
+        return;
+    tick_stop_.store(true, std::memory_order_release);
+    tick_epoch_.fetch_add(1, std::memory_order_release);
+    TickNotify(tick_start_cv_);
+    for (auto &worker : tick_workers_) {
+        worker.join();
+    }
+    tick_workers_.clear();
+    tick_threads_ = 1;
+    tick_stop_.store(false, std::memory_order_relaxed);
+}
+
+template <typename Pred>
+void BaseDRAMSystem::TickWait(std::condition_variable &cv, Pred done) {
+    for (int spins = 0; spins < kTickSpins; spins++) {
+        if (done())
+            return;
+    }
+    std::unique_lock<std::mutex> lock(tick_mutex_);
+    cv.wait(lock, done);
+}
+
+void BaseDRAMSystem::TickNotify(std::condition_variable &cv) {
+    // the waiter checks its predicate under the mutex, so taking it here
+    // orders the atomic update before the wake-up and none is lost
+    { std::lock_guard<std::mutex> lock(tick_mutex_); }
+    cv.notify_all();
+}
+
+void BaseDRAMSystem::TickWorker(int worker_id, uint64_t epoch) {
+    while (true) {
+        TickWait(tick_start_cv_,
+                 [&] { return tick_epoch_.load(std::memory_order_acquire) != epoch; });
+        epoch++;
+        if (tick_stop_.load(std::memory_order_acquire))
+            return;
+        for (size_t i = worker_id; i < ctrls_.size(); i += tick_threads_) {
+            ctrls_[i]->ClockTick();
+        }
+        if (tick_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            TickNotify(tick_done_cv_);
+    }
+}
+
+void BaseDRAMSystem::TickControllers() {
+    if (tick_workers_.empty()) {
+        for (size_t i = 0; i < ctrls_.size(); i++) {
+            ctrls_[i]->ClockTick();
+        }
+        return;
+    }
+    tick_pending_.store(tick_threads_ - 1, std::memory_order_relaxed);
+    tick_epoch_.fetch_add(1, std::memory_order_release);
+    TickNotify(tick_start_cv_);
+    for (size_t i = 0; i < ctrls_.size(); i += tick_threads_) {
+        ctrls_[i]->ClockTick();
+    }
+    TickWait(tick_done_cv_, [&] { return tick_pending_.load(std::memory_order_acquire) == 0; });
+}
+
 void BaseDRAMSystem::PrintEpochStats() {
     // first epoch, print bracket
     if (clk_ - config_.epoch_period == 0) {
@@ -119,6 +198,7 @@ void JedecDRAMSystem::ResetPIMCycle() {
 }
 
 JedecDRAMSystem::~JedecDRAMSystem() {
+    StopTickWorkers();
     for (auto it = ctrls_.begin(); it != ctrls_.end(); it++) {
         delete (*it);
     }
@@ -148,6 +228,14 @@ bool JedecDRAMSystem::AddTransaction(uint64_t hex_addr, TransactionType req_type
     return ok;
 }
 
+uint64_t JedecDRAMSystem::TicksToNextDone() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (auto ctrl : ctrls_) next = std::min(next, ctrl->NextDoneCycle());
+    if (next == std::numeric_limits<uint64_t>::max()) return next;
+    // done transactions are returned at the start of the tick at clk_
+    return next > clk_ ? next - clk_ + 1 : 1;
+}
+
 void JedecDRAMSystem::ClockTick() {
     for (size_t i = 0; i < ctrls_.size(); i++) {
         // look ahead and return earlier
@@ -167,9 +255,7 @@ void JedecDRAMSystem::ClockTick() {
             }
         }
     }
-    for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->ClockTick();
-    }
+    TickControllers();
     clk_++;
 
     if (clk_ % config_.epoch_period == 0) {
@@ -193,6 +279,13 @@ bool IdealDRAMSystem::AddTransaction(uint64_t hex_addr, TransactionType req_type
     return true;
 }
 
+uint64_t IdealDRAMSystem::TicksToNextDone() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (auto &trans : infinite_buffer_q_) next = std::min(next, trans.added_cycle + latency_);
+    if (next == std::numeric_limits<uint64_t>::max()) return next;
+    return next > clk_ ? next - clk_ + 1 : 1;
+}
+
 void IdealDRAMSystem::ClockTick() {
     for (auto trans_it = infinite_buffer_q_.begin(); trans_it != infinite_buffer_q_.end();) {
         if (clk_ - trans_it->added_cycle >= static_cast<uint64_t>(latency_)) {
@@ -1,8 +1,12 @@
 #ifndef __DRAM_SYSTEM_H
 #define __DRAM_SYSTEM_H
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common.h"
@@ -20,7 +24,7 @@ class BaseDRAMSystem {
     BaseDRAMSystem(Config &config, const std::string &output_dir,
                    std::function<void(uint64_t)> read_callback,
                    std::function<void(uint64_t)> write_callback);
-    virtual ~BaseDRAMSystem() {}
+    virtual ~BaseDRAMSystem() { StopTickWorkers(); }
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
     void PrintEpochStats();
@@ -30,7 +34,12 @@ class BaseDRAMSystem {
     virtual bool WillAcceptTransaction(uint64_t hex_addr, TransactionType req_type) const = 0;
     virtual bool AddTransaction(uint64_t hex_addr, TransactionType req_type) = 0;
     virtual void ClockTick() = 0;
+    // ClockTick() calls until one may return a transaction through the callbacks,
+    // max: nothing in flight
+    virtual uint64_t TicksToNextDone() const = 0;
     int GetChannel(uint64_t hex_addr) const;
+    // tick channel controllers on num_threads threads (including the caller)
+    void SetTickThreads(int num_threads);
 
     std::function<void(uint64_t req_id)> read_callback_, write_callback_;
     static int total_channels_;
@@ -48,9 +57,32 @@ class BaseDRAMSystem {
     uint64_t clk_;
     std::vector<Controller *> ctrls_;
 
+    // Channels only interact through the callbacks, which stay on the calling thread, so
+    // controller ticks can run in parallel. Worker w always owns channels w, w+n, w+2n, ...
+    // and every tick ends with a barrier, so results do not depend on the thread count.
+    // The barrier spins briefly (a tick is a few microseconds) and then blocks, so idle
+    // workers do not burn a core that the caller or another worker needs.
+    void TickControllers();
+    void StopTickWorkers();
+
 #ifdef ADDR_TRACE
     std::ofstream address_trace_;
 #endif // ADDR_TRACE
+
+  private:
+    int tick_threads_;
+    std::vector<std::thread> tick_workers_;
+    std::atomic<uint64_t> tick_epoch_;
+    std::atomic<int> tick_pending_;
+    std::atomic<bool> tick_stop_;
+    static constexpr int kTickSpins = 4096;
+    std::mutex tick_mutex_;
+    std::condition_variable tick_start_cv_;
+    std::condition_variable tick_done_cv_;
+    void TickWorker(int worker_id, uint64_t epoch);
+    template <typename Pred>
+    void TickWait(std::condition_variable &cv, Pred done);
+    void TickNotify(std::condition_variable &cv);
 };
 
 // hmmm not sure this is the best naming...
@@ -63,6 +95,7 @@ class JedecDRAMSystem : public BaseDRAMSystem {
     bool WillAcceptTransaction(uint64_t hex_addr, TransactionType req_type) const override;
     bool AddTransaction(uint64_t hex_addr, TransactionType req_type) override;
     void ClockTick() override;
+    uint64_t TicksToNextDone() const override;
     uint64_t GetAvgPIMCycles() override;
     void ResetPIMCycle() override;
 };
@@ -81,6 +114,7 @@ class IdealDRAMSystem : public BaseDRAMSystem {
     };
     bool AddTransaction(uint64_t hex_addr, TransactionType req_type) override;
     void ClockTick() override;
+    uint64_t TicksToNextDone() const override;
 
   private:
     int latency_;
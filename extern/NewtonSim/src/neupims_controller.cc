@@ -27,6 +27,18 @@ NeuPIMSController::NeuPIMSController(int channel, const Config &config, const Ti
 void NeuPIMSController::ResetPIMCycle() { pim_cmd_queue_.ResetPIMCycle(); }
 uint64_t NeuPIMSController::GetPIMCycle() { return pim_cmd_queue_.GetPIMCycle(); }
 
+uint64_t NeuPIMSController::NextDoneCycle() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (auto &trans : return_queue_) next = std::min(next, trans.complete_cycle);
+    // queued transactions return read_delay (gwrite_delay for GWRITE) after their command is
+    // issued, at the earliest now
+    if (!pending_rd_q_.empty() || !pending_pim_q_.empty()) {
+        int delay = std::min(config_.read_delay, config_.gwrite_delay);
+        next = std::min<uint64_t>(next, clk_ + delay);
+    }
+    return next;
+}
+
 // - [x] handle pim command
 std::pair<uint64_t, TransactionType> NeuPIMSController::ReturnDoneTrans(uint64_t clk) {
     auto it = return_queue_.begin();
@@ -27,6 +27,7 @@ class NeuPIMSController : public Controller {
     void PrintFinalStats() override;
     void ResetStats() override { simple_stats_.Reset(); }
     std::pair<uint64_t, TransactionType> ReturnDoneTrans(uint64_t clock) override;
+    uint64_t NextDoneCycle() const override;
 
     int channel_id_;
 
@@ -28,6 +28,14 @@ void NewtonController::ResetPIMCycle() { pim_cmd_queue_.ResetPIMCycle(); }
 uint64_t NewtonController::GetPIMCycle() { return pim_cmd_queue_.GetPIMCycle(); }
 
 // - [x] handle pim command
+uint64_t NewtonController::NextDoneCycle() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (auto &trans : return_queue_) next = std::min(next, trans.complete_cycle);
+    // some PIM commands complete as they issue
+    if (!pending_rd_q_.empty() || !pending_pim_q_.empty()) next = std::min(next, clk_);
+    return next;
+}
+
 std::pair<uint64_t, TransactionType> NewtonController::ReturnDoneTrans(uint64_t clk) {
     auto it = return_queue_.begin();
     while (it != return_queue_.end()) {
@@ -1,22 +1,62 @@
 #include "Common.h"
 
 uint32_t generate_id() {
-    static uint32_t id_counter{0};
+    static thread_local uint32_t id_counter{0};
     return id_counter++;
 }
 uint32_t generate_mem_access_id() {
-    static uint32_t id_counter{0};
+    static thread_local uint32_t id_counter{0};
     return id_counter++;
 }
 
 namespace AddressConfig {
-addr_type alignment = Config::global_config.dram_req_size;  // BL * dev width / 8 bytes
-addr_type channel_mask;                                     // not used
-addr_type channel_offset;                                   // not used
+// BL * dev width / 8 bytes
+thread_local addr_type alignment = Config::global_config.dram_req_size;
+thread_local addr_type channel_mask;    // not used
+thread_local addr_type channel_offset;  // not used
+
+// field widths of make_address, HBM2_8Gb_s128_pim.ini
+constexpr int rank_bits = 1;
+constexpr int bankgroup_bits = 2;
+constexpr int bank_bits = 2;
 }  // namespace AddressConfig
 
-int MemoryAccess::req_count = 0;
-int MemoryAccess::pre_req_count = 0;
+thread_local int MemoryAccess::req_count = 0;
+thread_local int MemoryAccess::pre_req_count = 0;
+
+namespace {
+class MemoryAccessPool {
+   public:
+    MemoryAccess *allocate() {
+        if (_free_list.empty()) grow();
+        MemoryAccess *access = _free_list.back();
+        _free_list.pop_back();
+        return access;
+    }
+    void release(MemoryAccess *access) { _free_list.push_back(access); }
+
+   private:
+    static constexpr size_t SLAB_SIZE = 4096;
+    std::vector<std::unique_ptr<MemoryAccess[]>> _slabs;
+    std::vector<MemoryAccess *> _free_list;
+
+    void grow() {
+        _slabs.push_back(std::make_unique<MemoryAccess[]>(SLAB_SIZE));
+        MemoryAccess *slab = _slabs.back().get();
+        // hand out slab entries in address order
+        for (size_t i = SLAB_SIZE; i > 0; i--) _free_list.push_back(&slab[i - 1]);
+    }
+};
+thread_local MemoryAccessPool mem_access_pool;
+}  // namespace
+
+MemoryAccess *MemoryAccess::create(const MemoryAccess &init) {
+    MemoryAccess *access = mem_access_pool.allocate();
+    *access = init;
+    return access;
+}
+
+void MemoryAccess::release(MemoryAccess *access) { mem_access_pool.release(access); }
 
 // FIXME: Magic Numbers
 uint32_t AddressConfig::mask_channel(addr_type address) {
@@ -52,7 +92,7 @@ addr_type AddressConfig::switch_co_ch(addr_type addr) {
 // align cachline size to 4B
 // ex) allocate 31 bytes => align to 32 bytes
 addr_type AddressConfig::allocate_address(uint32_t size) {
-    static addr_type base_addr{0};
+    static thread_local addr_type base_addr{0};
 
     addr_type result = base_addr;
     base_addr += size;
@@ -75,26 +115,56 @@ std::vector<MemoryAccess *> MemoryAccess::from_instruction(Instruction &inst, ui
                                                            bool request, uint32_t core_id,
                                                            cycle_type start_cycle, int buffer_id,
                                                            StagePlatform stage_platform) {
-    static addr_type const_addr = 0;
+    static thread_local addr_type const_addr = 0;
     const addr_type max_address = Config::global_config.model_n_embd *
                                   Config::global_config.model_n_embd * 5 * 2 /
                                   Config::global_config.n_tp;
 
-    robin_hood::unordered_set<addr_type> aligned_src_addrs;
-    for (auto addr : inst.src_addrs) {
-        pre_req_count++;
-        const_addr += 2;
-        if (const_addr >= max_address) {
-            const_addr = 0;
+    std::vector<addr_type> aligned_src_addrs;
+    pre_req_count += inst.src_ranges.size();
+    if (Config::global_config.real_addresses) {
+        // tensor addresses are already channel-interleaved by get_addr (switch_co_ch).
+        // Coalesce each run into dram_req_size bursts in first-touch order, consecutive runs in
+        // one burst are skipped without a set lookup.
+        robin_hood::unordered_set<addr_type> seen;
+        addr_type last_aligned = GARBAGE_ADDR;
+        for (auto &range : inst.src_ranges.ranges()) {
+            for (uint32_t i = 0; i < range.count; i++) {
+                addr_type begin = range.base + i * range.stride;
+                for (addr_type aligned = AddressConfig::align(begin); aligned < begin + range.burst;
+                     aligned += AddressConfig::alignment) {
+                    if (aligned == last_aligned) continue;
+                    last_aligned = aligned;
+                    if (seen.insert(aligned).second) aligned_src_addrs.push_back(aligned);
+                }
+            }
         }
-        aligned_src_addrs.insert(AddressConfig::align(AddressConfig::switch_co_ch(const_addr)));
+    } else {
+        // synthetic stream advancing 2 bytes per element. switch_co_ch keeps the low 6 bits, so
+        // all elements in one such block share an aligned address and it is inserted once.
+        const addr_type block = std::min<addr_type>(AddressConfig::alignment, 1 << 6);
+        robin_hood::unordered_set<addr_type> synthetic_addrs;
+        size_t remaining = inst.src_ranges.size();
+        while (remaining > 0) {
+            const_addr += 2;
+            if (const_addr >= max_address) {
+                const_addr = 0;
+            }
+            synthetic_addrs.insert(AddressConfig::align(AddressConfig::switch_co_ch(const_addr)));
+            addr_type limit = std::min(const_addr - const_addr % block + block, max_address);
+            size_t skip = std::min<size_t>(remaining - 1, (limit - 1 - const_addr) / 2);
+            const_addr += 2 * skip;
+            remaining -= skip + 1;
+        }
+        aligned_src_addrs.assign(synthetic_addrs.begin(), synthetic_addrs.end());
     }
 
     std::vector<MemoryAccess *> ret;
+    Tile *parent_tile = inst.parent_tile.lock().get();
     for (auto &addr : aligned_src_addrs) {
         req_count++;
 
-        MemoryAccess *mem_access = new MemoryAccess{
+        MemoryAccess *mem_access = MemoryAccess::create({
             .id = id,
             .dram_address = addr,
             .spad_address = inst.dest_addr,
@@ -104,11 +174,12 @@ std::vector<MemoryAccess *> MemoryAccess::from_instruction(Instruction &inst, ui
             .core_id = core_id,
             .start_cycle = start_cycle,
             .buffer_id = buffer_id,
-            .parent_tile = inst.parent_tile,
+            .parent_tile = parent_tile,
             .stage_platform = stage_platform,
-        };
+        });
         ret.push_back(mem_access);
     }
+    if (parent_tile != nullptr) parent_tile->inflight_accesses += ret.size();
 
     return ret;
 }
@@ -141,7 +212,7 @@ void PrintColor(Color color, std::string str) {
     std::cout << color_code << str << "\033[0m" << std::endl;
 }
 
-SimulationConfig Config::global_config;
+thread_local SimulationConfig Config::global_config;
 
 SimulationConfig initialize_config(json config) {
     SimulationConfig parsed_config;
@@ -220,6 +291,7 @@ void initialize_memory_config(std::string mem_config_path) {
     Config::global_config.dram_channels = mem_config["dram_channels"];
     if (mem_config.contains("dram_req_size"))
         Config::global_config.dram_req_size = mem_config["dram_req_size"];
+    Config::global_config.dram_tick_threads = mem_config.value("dram_tick_threads", 1);
 
     /* PIM config */
     if (mem_config.contains("pim_config_path")) {
@@ -237,6 +309,8 @@ void initialize_memory_config(std::string mem_config_path) {
 
 void initialize_client_config(std::string cli_config_path) {
     Config::global_config.request_dataset_path = cli_config_path;
+    Config::global_config.request_offset = 0;
+    Config::global_config.request_stride = 1;
 
     // json cli_config = load_config(cli_config_path);
     // /* Client config */
@@ -280,6 +354,7 @@ void initialize_model_config(std::string model_config_path) {
     Config::global_config.model_n_embd = model_config["model_n_embd"];
     /* parallelism config */
     Config::global_config.n_tp = model_config["n_tp"];
+    Config::global_config.n_pp = std::max(1u, model_config.value("n_pp", 1u));
     /* MoE configs */
     Config::global_config.moe_enabled = model_config.value("moe_enabled", false);
     Config::global_config.num_experts = model_config.value("num_experts", 1);
@@ -295,6 +370,21 @@ void initialize_model_config(std::string model_config_path) {
     Config::global_config.moe_enable_double_buffering = model_config.value("moe_enable_double_buffering", true);
     Config::global_config.moe_routing_trace_path = model_config.value("moe_routing_trace_path", std::string(""));
 }
+
+static SubBatchPartition parse_sub_batch_partition(std::string partition) {
+    if (partition == "simple") return SubBatchPartition::SIMPLE;
+    if (partition == "dp") return SubBatchPartition::DP;
+    return SubBatchPartition::BALANCED;
+}
+
+static StageSchedule parse_stage_schedule(std::string schedule) {
+    return schedule == "dynamic" ? StageSchedule::DYNAMIC : StageSchedule::STATIC;
+}
+
+static KVPreemption parse_kv_preemption(std::string preemption) {
+    return preemption == "swap" ? KVPreemption::SWAP : KVPreemption::RECOMPUTE;
+}
+
 void initialize_system_config(std::string sys_config_path) {
     json sys_config = load_config(sys_config_path);
     /* Batch configs */
@@ -306,6 +396,7 @@ void initialize_system_config(std::string sys_config_path) {
         Config::global_config.run_mode = RunMode::NPU_ONLY;
 
     Config::global_config.ch_load_balancing = sys_config["ch_load_balancing"];
+    Config::global_config.online_ch_balancing = sys_config.value("online_ch_balancing", false);
 
     Config::global_config.kernel_fusion = sys_config["kernel_fusion"];
 
@@ -314,6 +405,98 @@ void initialize_system_config(std::string sys_config_path) {
     Config::global_config.max_batch_size = sys_config["max_batch_size"];
 
     Config::global_config.sub_batch_mode = sys_config["sub_batch_mode"];
+    Config::global_config.sub_batch_partition =
+        parse_sub_batch_partition(sys_config.value("sub_batch_partition", std::string("balanced")));
+    Config::global_config.sub_batches = std::max(2u, sys_config.value("sub_batches", 2u));
+    Config::global_config.stage_schedule =
+        parse_stage_schedule(sys_config.value("stage_schedule", std::string("static")));
+
+    Config::global_config.fast_forward = sys_config.value("fast_forward", false);
+    Config::global_config.real_addresses = sys_config.value("real_addresses", false);
+    Config::global_config.tile_lookahead = std::max(1u, sys_config.value("tile_lookahead", 2u));
+    Config::global_config.tile_cache_tiles = sys_config.value("tile_cache_tiles", 4096);
+    Config::global_config.analytical_gemm = sys_config.value("analytical_gemm", false);
+    Config::global_config.analytical_gemm_samples =
+        std::max(1u, sys_config.value("analytical_gemm_samples", 2u));
+    Config::global_config.tp_row_parallel = sys_config.value("tp_row_parallel", true);
+
+    std::string layer_sim_mode = sys_config.value("layer_sim_mode", std::string("single"));
+    if (layer_sim_mode == "full")
+        Config::global_config.layer_sim_mode = LayerSimMode::FULL;
+    else if (layer_sim_mode == "sampled")
+        Config::global_config.layer_sim_mode = LayerSimMode::SAMPLED;
+    else
+        Config::global_config.layer_sim_mode = LayerSimMode::SINGLE;
+    Config::global_config.sampled_layers = sys_config.value("sampled_layers", 4);
+    Config::global_config.multi_iteration = sys_config.value("multi_iteration", false);
+    Config::global_config.checkpoint_stage =
+        sys_config.value("checkpoint_stage", std::string(""));
+    Config::global_config.checkpoint_continuations =
+        sys_config.value("checkpoint_continuations", json::array());
+    Config::global_config.slo_ttft_cycles = sys_config.value("slo_ttft_cycles", 0);
+    Config::global_config.slo_tpot_cycles = sys_config.value("slo_tpot_cycles", 0);
+    Config::global_config.kv_rows_per_channel = sys_config.value("kv_rows_per_channel", 0);
+    Config::global_config.kv_preemption =
+        parse_kv_preemption(sys_config.value("kv_preemption", std::string("recompute")));
+    Config::global_config.kv_swap_bandwidth_gbps = sys_config.value("kv_swap_bandwidth_gbps", 16);
+    Config::global_config.kv_migration = sys_config.value("kv_migration", false);
+    Config::global_config.kv_migration_threshold = sys_config.value("kv_migration_threshold", 1.25);
+    Config::global_config.pipeline_parallel = sys_config.value("pipeline_parallel", false);
+    Config::global_config.pp_micro_batches =
+        std::max(1u, sys_config.value("pp_micro_batches", Config::global_config.n_pp));
+    Config::global_config.pp_link_bandwidth_gbps = sys_config.value("pp_link_bandwidth_gbps", 64);
+    Config::global_config.pp_link_latency = sys_config.value("pp_link_latency", 1000);
+
+    std::string arrival_mode = sys_config.value("arrival_mode", std::string("batch"));
+    if (arrival_mode == "poisson")
+        Config::global_config.arrival_mode = ArrivalMode::POISSON;
+    else if (arrival_mode == "gamma")
+        Config::global_config.arrival_mode = ArrivalMode::GAMMA;
+    else if (arrival_mode == "trace")
+        Config::global_config.arrival_mode = ArrivalMode::TRACE;
+    else
+        Config::global_config.arrival_mode = ArrivalMode::BATCH;
+    Config::global_config.arrival_qps = sys_config.value("arrival_qps", 1.0);
+    Config::global_config.arrival_burstiness = sys_config.value("arrival_burstiness", 1.0);
+    Config::global_config.arrival_seed = sys_config.value("arrival_seed", 0);
+}
+
+// A checkpoint continuation only changes settings that components read while running: the
+// scheduling policies, which the scheduler takes up at its next iteration, and run options.
+// Anything that sizes or builds their state (batch sizes, sub-batches, KV rows, memory, cores,
+// ...) is fixed at the fork, the simulator state itself is not snapshotted.
+static const std::set<std::string> continuation_config_keys = {
+    "fast_forward",        "tile_lookahead", "kv_migration_threshold", "slo_ttft_cycles",
+    "slo_tpot_cycles",     "sub_batch_partition", "stage_schedule",  "kv_preemption",
+    "online_ch_balancing", "ch_load_balancing"};
+
+bool check_continuation_config(const json &overrides) {
+    bool valid = overrides.is_object();
+    for (auto &[key, value] : overrides.items()) {
+        if (continuation_config_keys.count(key)) continue;
+        spdlog::error("Continuation sys_config cannot change {}", key);
+        valid = false;
+    }
+    return valid;
+}
+
+void apply_continuation_config(const json &overrides) {
+    auto &config = Config::global_config;
+    config.fast_forward = overrides.value("fast_forward", config.fast_forward);
+    config.tile_lookahead = std::max(1u, overrides.value("tile_lookahead", config.tile_lookahead));
+    config.kv_migration_threshold =
+        overrides.value("kv_migration_threshold", config.kv_migration_threshold);
+    config.slo_ttft_cycles = overrides.value("slo_ttft_cycles", config.slo_ttft_cycles);
+    config.slo_tpot_cycles = overrides.value("slo_tpot_cycles", config.slo_tpot_cycles);
+    if (overrides.contains("sub_batch_partition"))
+        config.sub_batch_partition = parse_sub_batch_partition(overrides["sub_batch_partition"]);
+    if (overrides.contains("stage_schedule"))
+        config.stage_schedule = parse_stage_schedule(overrides["stage_schedule"]);
+    if (overrides.contains("kv_preemption"))
+        config.kv_preemption = parse_kv_preemption(overrides["kv_preemption"]);
+    config.online_ch_balancing =
+        overrides.value("online_ch_balancing", config.online_ch_balancing);
+    config.ch_load_balancing = overrides.value("ch_load_balancing", config.ch_load_balancing);
 }
 
 json load_config(std::string config_path) {
@@ -403,6 +586,8 @@ std::string Instruction::repr() {
     }
     ret += " / src_addrs.size() : ";
     ret += std::to_string(src_addrs.size());
+    ret += " / src_ranges.size() : ";
+    ret += std::to_string(src_ranges.size());
     ret += " / dest_addrs : ";
     ret += to_hex(dest_addr);
     return ret;
@@ -493,11 +678,17 @@ MemoryAccess *TransToMemoryAccess(Instruction &inst, uint32_t size, uint32_t cor
             break;
     }
 
-    auto it = inst.src_addrs.begin();
-    assert(it != inst.src_addrs.end());
-    addr_type dram_addr = *it;
+    // PIM instructions carry their DRAM row in src_addrs, MOVIN/MOVOUT their ranges
+    addr_type dram_addr;
+    if (inst.opcode == Opcode::MOVIN || inst.opcode == Opcode::MOVOUT) {
+        assert(!inst.src_ranges.empty());
+        dram_addr = inst.src_ranges.ranges().front().base;
+    } else {
+        assert(!inst.src_addrs.empty());
+        dram_addr = inst.src_addrs.front();
+    }
 
-    MemoryAccess *mem_request = new MemoryAccess{
+    MemoryAccess *mem_request = MemoryAccess::create({
         .id = generate_mem_access_id(),
         .dram_address = dram_addr,
         .spad_address = inst.dest_addr,
@@ -507,9 +698,12 @@ MemoryAccess *TransToMemoryAccess(Instruction &inst, uint32_t size, uint32_t cor
         .core_id = core_id,
         .start_cycle = start_cycle,
         .buffer_id = buffer_id,
-        .parent_tile = inst.parent_tile,
+        .parent_tile = inst.parent_tile.lock().get(),
         .stage_platform = stage_platform,
-    };
+    });
+    // pim_header request does not receive response
+    if (mem_request->parent_tile != nullptr && req_type != MemoryAccessType::P_HEADER)
+        mem_request->parent_tile->inflight_accesses++;
     return mem_request;
 }
 
@@ -528,10 +722,6 @@ uint64_t AddressConfig::make_address(int channel, int rank, int bankgroup, int b
     // HBM2_8Gb_s128_pim.ini
     uint64_t addr = 0;
 
-    int row_bits = 15;
-    int rank_bits = 1;
-    int bankgroup_bits = 2;
-    int bank_bits = 2;
     int channel_bits = LogBase2(Config::global_config.dram_channels);
     int col_bits = 4;
     int offset = 6;
@@ -567,6 +757,15 @@ uint64_t AddressConfig::make_address(int channel, int rank, int bankgroup, int b
     return addr;
 }
 
+// bank_idx counts the banks of a channel in make_address order (bank, then bankgroup, then rank)
+uint64_t AddressConfig::make_bank_address(int channel, int bank_idx, int row, int col) {
+    assert(bank_idx < 1 << (rank_bits + bankgroup_bits + bank_bits));
+    int bank = bank_idx & ((1 << bank_bits) - 1);
+    int bankgroup = (bank_idx >> bank_bits) & ((1 << bankgroup_bits) - 1);
+    int rank = (bank_idx >> (bank_bits + bankgroup_bits)) & ((1 << rank_bits) - 1);
+    return make_address(channel, rank, bankgroup, bank, row, col);
+}
+
 uint64_t AddressConfig::encode_pim_header(int channel, int row, bool for_gwrite, int num_comps,
                                           int num_readres) {
     int gwrite_bit = for_gwrite ? 1 : 0;
@@ -611,6 +810,24 @@ std::string stageToString(Stage stage) {
     return (it != stageMap.end()) ? it->second : "unknown";
 }
 
+// C/D repeat once per simulated layer pair unless only one layer is simulated,
+// all stages repeat once per decode iteration (multi_iteration or open-loop arrivals).
+// With more than two sub_batches, B/D/F repeat once per sub-batch after the first (sub_stage).
+std::string stageLayerToString(Stage stage, uint32_t layer_pair, uint32_t iteration,
+                               uint32_t sub_stage) {
+    std::string name = stageToString(stage);
+    if (sub_stage > 0 && Config::global_config.sub_batch_mode &&
+        Config::global_config.sub_batches > 2)
+        name += std::to_string(sub_stage);
+    bool repeated = stage == Stage::C || stage == Stage::D;
+    if (repeated && Config::global_config.layer_sim_mode != LayerSimMode::SINGLE)
+        name += "_L" + std::to_string(layer_pair);
+    if (Config::global_config.multi_iteration ||
+        Config::global_config.arrival_mode != ArrivalMode::BATCH)
+        name += "_I" + std::to_string(iteration);
+    return name;
+}
+
 std::string stagePlatformToString(StagePlatform sp) {
     static const std::map<StagePlatform, std::string> spMap = {
         {StagePlatform::SA, "SA"},
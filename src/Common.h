@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <queue>
@@ -53,21 +54,96 @@ typedef uint64_t addr_type;
 typedef uint64_t cycle_type;
 
 namespace AddressConfig {
-extern addr_type alignment;
-extern addr_type channel_mask;
-extern addr_type channel_offset;
+extern thread_local addr_type alignment;
+extern thread_local addr_type channel_mask;
+extern thread_local addr_type channel_offset;
 
 uint32_t mask_channel(addr_type address);
 addr_type allocate_address(uint32_t size);
 addr_type align(addr_type addr);
 
 uint64_t make_address(int channel, int rank, int bankgroup, int bank, int row, int col);
+uint64_t make_bank_address(int channel, int bank_idx, int row, int col);
 uint64_t encode_pim_header(int channel, int row, bool for_gwrite, int num_comps, int num_readres);
 uint64_t encode_pim_comps_readres(int ch, int row, int num_comps, bool last_cmd);
 
 addr_type switch_co_ch(addr_type addr);
 }  // namespace AddressConfig
 
+// `count` runs of `burst` bytes, the i-th starting at base + i * stride
+struct AddrRange {
+    addr_type base;
+    addr_type stride;
+    uint32_t count;
+    uint32_t burst;
+};
+
+// DRAM addresses of a MOVIN/MOVOUT. Elements pushed one by one are merged into contiguous runs
+// and runs of equal length at a fixed stride are folded into one AddrRange, so a tile keeps a
+// handful of descriptors instead of one address per element.
+class AddrRanges {
+   public:
+    AddrRanges() = default;
+    AddrRanges(const AddrRanges &other) = default;
+    AddrRanges &operator=(const AddrRanges &other) = default;
+    // a moved-from list is left empty, as std::vector is
+    AddrRanges(AddrRanges &&other) noexcept
+        : _ranges(std::move(other._ranges)), _size(std::exchange(other._size, 0)) {
+        other._ranges.clear();
+    }
+    AddrRanges &operator=(AddrRanges &&other) noexcept {
+        _ranges = std::move(other._ranges);
+        _size = std::exchange(other._size, 0);
+        other._ranges.clear();
+        return *this;
+    }
+
+    // one element of `precision` bytes
+    void push_back(addr_type addr) {
+        uint32_t bytes = Config::global_config.precision;
+        _size++;
+        if (!_ranges.empty()) {
+            AddrRange &last = _ranges.back();
+            if (last.count == 1 && addr == last.base + last.burst) {
+                last.burst += bytes;
+                return;
+            }
+            fold();
+        }
+        _ranges.push_back(AddrRange{addr, 0, 1, bytes});
+    }
+    void push_range(AddrRange range) {
+        fold();
+        _ranges.push_back(range);
+        _size += (uint64_t)range.count * range.burst / Config::global_config.precision;
+    }
+    void append(const AddrRanges &other) {
+        for (auto &range : other._ranges) push_range(range);
+    }
+
+    size_t size() const { return _size; }  // # of elements
+    bool empty() const { return _size == 0; }
+    const std::vector<AddrRange> &ranges() const { return _ranges; }
+
+   private:
+    std::vector<AddrRange> _ranges;
+    size_t _size = 0;
+
+    // fold the closed run at the back into the range before it if it continues its stride
+    void fold() {
+        if (_ranges.size() < 2) return;
+        AddrRange &last = _ranges.back();
+        AddrRange &prev = _ranges[_ranges.size() - 2];
+        if (last.count != 1 || last.burst != prev.burst) return;
+        if (prev.count == 1)
+            prev.stride = last.base - prev.base;
+        else if (last.base != prev.base + prev.count * prev.stride)
+            return;
+        prev.count++;
+        _ranges.pop_back();
+    }
+};
+
 enum class Color { RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, DEFAULT };
 
 enum class Opcode {
@@ -104,7 +180,8 @@ struct Instruction {
     std::string dest_id;
     addr_type dest_addr;
     uint32_t size;
-    std::vector<addr_type> src_addrs;
+    std::vector<addr_type> src_addrs;  // spad keys of compute, DRAM row of PIM instructions
+    AddrRanges src_ranges = {};        // DRAM addresses of MOVIN/MOVOUT
     int spad_id;
     int accum_spad_id;
     uint32_t operand_id = 0;
@@ -173,7 +250,13 @@ struct Tile {
     // count up for the compute instruction
     // populate accurate memory request when store instruction is decoded
     uint32_t remaining_accum_io;
+    // accesses in the memory system that will be answered, the core keeps the tile until
+    // they are all back since they point at it (MemoryAccess::parent_tile)
+    uint32_t inflight_accesses = 0;
     StagePlatform stage_platform;  // SA program / PIM program (for sub-batch interleaving)
+    // > 0: costed by GemmModel, holds the systolic array this long and has no instructions
+    cycle_type analytical_cycles = 0;
+    uint32_t barrier_tiles = 0;  // BAR: passed once this many tiles of the operation finished
     std::string repr();
 };
 
@@ -183,20 +266,20 @@ std::string memAccessTypeString(MemoryAccessType type);
 std::string opcodeTypeString(Opcode opcode);
 
 typedef struct MemoryAccess {
-    static int req_count;
-    static int pre_req_count;
-
-    uint32_t id;
-    addr_type dram_address;
-    addr_type spad_address;
-    uint64_t size;
-    MemoryAccessType req_type;
-    bool request;
-    uint32_t core_id;
-    cycle_type start_cycle;
-    cycle_type dram_enter_cycle;
-    cycle_type dram_finish_cycle;
-    int buffer_id;
+    static thread_local int req_count;
+    static thread_local int pre_req_count;
+
+    uint32_t id = 0;
+    addr_type dram_address = 0;
+    addr_type spad_address = 0;
+    uint64_t size = 0;
+    MemoryAccessType req_type = MemoryAccessType::READ;
+    bool request = true;
+    uint32_t core_id = 0;
+    cycle_type start_cycle = 0;
+    cycle_type dram_enter_cycle = 0;
+    cycle_type dram_finish_cycle = 0;
+    int buffer_id = 0;
 
     static std::vector<MemoryAccess *> from_instruction(Instruction &inst, uint32_t id,
                                                         uint32_t size, MemoryAccessType req_type,
@@ -204,9 +287,15 @@ typedef struct MemoryAccess {
                                                         cycle_type start_cycle, int buffer_id,
                                                         StagePlatform stage_platform);
 
-    std::weak_ptr<Tile> parent_tile;
+    // accesses are carved from slabs and recycled instead of new/delete,
+    // release() once the response has been consumed
+    static MemoryAccess *create(const MemoryAccess &init);
+    static void release(MemoryAccess *access);
+
+    // non-owning, kept alive by the core until the tile's inflight_accesses drops to zero
+    Tile *parent_tile = nullptr;
     // SA program / PIM program (for sub-batch interleaving)
-    StagePlatform stage_platform;
+    StagePlatform stage_platform{};
 
     static void log_count() {
         spdlog::info("total pre req count {} / memory request count {}", pre_req_count, req_count);
@@ -222,6 +311,8 @@ void initialize_memory_config(std::string mem_config_path);
 void initialize_client_config(std::string cli_config_path);
 void initialize_model_config(std::string model_config_path);
 void initialize_system_config(std::string sys_config_path);
+bool check_continuation_config(const json &overrides);
+void apply_continuation_config(const json &overrides);
 
 std::string to_hex(uint32_t input);
 template <typename... Args>
@@ -239,22 +330,27 @@ std::string name_gen(Args... args) {
 class BTensor;
 typedef struct {
     // client to scheduler.
-    uint32_t id;
-    uint32_t arrival_cycle;    // time spend on client == arrival time to scheduler
-    uint32_t completed_cycle;  // return time to client
+    uint32_t id = 0;
+    cycle_type arrival_cycle = 0;    // time spend on client == arrival time to scheduler
+    cycle_type completed_cycle = 0;  // return time to client
 
     // request demand
-    uint32_t input_size;   // input sequence length
-    uint32_t output_size;  // # tokens to generate
+    uint32_t input_size = 0;   // input sequence length
+    uint32_t output_size = 0;  // # tokens to generate
 
     // request status
-    bool is_initiated;   // whether initialization phase is done
-    uint32_t generated;  // # tokens generated
+    bool is_initiated = false;  // whether initialization phase is done
+    uint32_t generated = 0;     // # tokens generated
+    std::vector<cycle_type> token_cycles = {};  // cycle each generated token finished
     // mapped channel
-    int channel;
+    int channel = 0;
+    // requests of the same hash share their first prefix_len tokens, 0: none
+    uint32_t prefix_hash = 0;
+    uint32_t prefix_len = 0;
+    cycle_type swap_ready_cycle = 0;  // a swapped-out request rejoins once its KV cache is back
 
-    std::vector<Ptr<BTensor>> K_cache;
-    std::vector<Ptr<BTensor>> V_cache;
+    std::vector<Ptr<BTensor>> K_cache = {};
+    std::vector<Ptr<BTensor>> V_cache = {};
 
 } InferRequest;
 
@@ -266,10 +362,11 @@ std::vector<T> slice(std::vector<T> &inp, int start, int end) {
     return std::vector<T>(inp.begin() + start, inp.begin() + end);
 }
 
+// one instance per thread, i.e. per simulation in a sweep
 template <typename T>
 class Singleton {
    protected:
-    static T *instance;
+    static thread_local T *instance;
 
    public:
     static T *GetInstance() {
@@ -277,10 +374,13 @@ class Singleton {
 
         return instance;
     }
-    static void Delete() { delete instance; }
+    static void Delete() {
+        delete instance;
+        instance = nullptr;
+    }
 };
 template <typename T>
-T *Singleton<T>::instance = nullptr;
+thread_local T *Singleton<T>::instance = nullptr;
 
 MemoryAccess *TransToMemoryAccess(Instruction &inst, uint32_t size, uint32_t core_id,
                                   cycle_type start_cycle, int buffer_id,
@@ -292,5 +392,7 @@ int LogBase2(int power_of_two);
 enum class Stage { A, B, C, D, E, F, Finish };
 enum class StagePlatform { SA, PIM, SIZE };
 std::string stageToString(Stage stage);
+std::string stageLayerToString(Stage stage, uint32_t layer_pair, uint32_t iteration,
+                               uint32_t sub_stage = 0);
 std::string stagePlatformToString(StagePlatform sp);
 //
\ No newline at end of file
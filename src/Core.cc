@@ -186,7 +186,7 @@ void Core::cycle() {
         // spdlog::info("tile remain_accum_io: {}, remain_computes: {}, remain_loads: {}",
         //              tile->remaining_accum_io, tile->remaining_computes, tile->remaining_loads);
         if ((tile->remaining_accum_io == 0) && (tile->remaining_computes == 0) &&
-            (tile->remaining_loads == 0)) {
+            (tile->remaining_loads == 0) && (tile->inflight_accesses == 0)) {
             tile->status = Tile::Status::FINISH;
             _finished_tiles.push(tile);
             tile_it = _tiles.erase(tile_it);
@@ -225,7 +225,9 @@ void Core::push_memory_response(MemoryAccess *response) {
 
     bool is_write = response->req_type == MemoryAccessType::WRITE;
     bool is_read = response->req_type == MemoryAccessType::READ;
-    if (auto tile = response->parent_tile.lock()) {
+    if (auto tile = response->parent_tile) {
+        assert(tile->inflight_accesses > 0);
+        tile->inflight_accesses--;
         if (is_write) {
             tile->remaining_accum_io--;
         } else {
@@ -248,7 +250,7 @@ void Core::push_memory_response(MemoryAccess *response) {
         // case3: load activation or weight to _spad
         _spad.fill(response->spad_address, response->buffer_id);
     }
-    delete response;
+    MemoryAccess::release(response);
 }
 
 // checks if inputs are loaded.
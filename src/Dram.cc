@@ -6,6 +6,7 @@
 
 PIM::PIM(SimulationConfig config)
     : _mem(std::make_unique<dramsim3::NewtonSim>(config.pim_config_path, config.log_dir)) {
+    _mem->SetTickThreads(config.dram_tick_threads);
     _total_processed_requests.resize(config.dram_channels);
     _processed_requests.resize(config.dram_channels);
 
@@ -109,7 +110,10 @@ void PIM::push(uint32_t cid, MemoryAccess *request) {
     request->request = false;
 
     _mem_req_cnt++;
+    if (request->req_type != MemoryAccessType::P_HEADER) _inflight_reqs++;
     _mem->AddTransaction(target_addr, int(request->req_type), request);
+    // pim_header request does not receive response
+    if (request->req_type == MemoryAccessType::P_HEADER) MemoryAccess::release(request);
 }
 
 bool PIM::is_empty(uint32_t cid) {
@@ -157,6 +161,15 @@ void PIM::pop(uint32_t cid) {
 
     assert(!is_empty(cid));
     _mem->Pop(cid);
+    _inflight_reqs--;
+}
+
+cycle_type PIM::cycles_to_next_event() {
+    if (_inflight_reqs == 0) return std::numeric_limits<cycle_type>::max();
+    for (uint32_t ch = 0; ch < _config.dram_channels; ch++) {
+        if (!_mem->IsEmpty(ch)) return 0;
+    }
+    return _mem->TicksToNextResponse();
 }
 
 uint32_t PIM::get_channel_id(MemoryAccess *access) {
@@ -179,8 +192,8 @@ void PIM::print_stat() {
     _mem->PrintStats();
 }
 
-void PIM::log(Stage stage) {
-    std::string fname = Config::global_config.log_dir + "/mem_io_" + stageToString(stage) + "_ch_";
+void PIM::log(std::string stage_name) {
+    std::string fname = Config::global_config.log_dir + "/mem_io_" + stage_name + "_ch_";
     for (size_t i = 0; i < _stats.size(); ++i) {
         Logger::log(_stats[i], fname + std::to_string(i));
         auto last_stat = _stats[i].back();
@@ -207,4 +220,11 @@ uint64_t PIM::get_avg_pim_cycle() {
 
 void PIM::reset_pim_cycle() { _mem->ResetPIMCycle(); }
 
+void PIM::set_tick_threads(int num_threads) { _mem->SetTickThreads(num_threads); }
+
+void PIM::set_log_dir(const std::string &log_dir) {
+    _config.log_dir = log_dir;
+    _mem->SetOutputDir(log_dir);
+}
+
 // <<< gsheo
@@ -20,12 +20,19 @@ class Dram {
     virtual void pop(uint32_t cid) = 0;
     virtual uint32_t get_channel_id(MemoryAccess *request) = 0;
     virtual void print_stat() {}
+    // DRAM is ticked every cycle even when fast-forwarding (refresh and bank timing are internal).
+    // DRAM cycles until a response may come out of a channel, 0: one is waiting, max: nothing in
+    // flight
+    virtual cycle_type cycles_to_next_event() { return 0; }
+    // for forked checkpoint continuations
+    virtual void set_tick_threads(int) {}
+    virtual void set_log_dir(const std::string &) {}
     addr_type get_addr_align() { return _addr_align; }
 
     virtual double get_avg_bw_util() = 0;
     virtual uint64_t get_avg_pim_cycle() = 0;
     virtual void reset_pim_cycle() = 0;
-    virtual void log(Stage stage) = 0;
+    virtual void log(std::string stage_name) = 0;
 
    protected:
     SimulationConfig _config;
@@ -47,16 +54,20 @@ class PIM : public Dram {
     virtual void pop(uint32_t cid) override;
     virtual uint32_t get_channel_id(MemoryAccess *request) override;
     virtual void print_stat() override;
+    virtual cycle_type cycles_to_next_event() override;
+    virtual void set_tick_threads(int num_threads) override;
+    virtual void set_log_dir(const std::string &log_dir) override;
 
     uint64_t MakeAddress(int channel, int rank, int bankgroup, int bank, int row, int col);
     uint64_t EncodePIMHeader(int channel, int row, bool for_gwrite, int num_comps, int num_readres);
     void update_stat(uint32_t cid);
-    void log(Stage stage);
+    void log(std::string stage_name);
 
     std::unique_ptr<dramsim3::NewtonSim> _mem;
     std::vector<uint64_t> _total_processed_requests;
     std::vector<uint64_t> _processed_requests;
     int _mem_req_cnt = 0;
+    uint64_t _inflight_reqs = 0;  // requests waiting for a response (P_HEADER has none)
     int _burst_cycle;
     std::vector<std::vector<MemoryIOStat>> _stats;
     uint64_t _stat_interval;
@@ -2,6 +2,8 @@
 
 #include <cmath>
 #include <filesystem>
+#include <functional>
+#include <type_traits>
 
 #include "booksim2/Interconnect.hpp"
 
@@ -18,12 +20,38 @@ void Interconnect::log(Stage stage) {
     }
 }
 
-cycle_type Interconnect::get_core_cycle() {
-    return (cycle_type)((double)_cycles * (double)Config::global_config.core_freq /
+cycle_type Interconnect::get_core_cycle() { return get_core_cycle(_cycles); }
+
+// replays the stat window rollover of cycle() for skipped cycles up to end_cycle
+void Interconnect::replay_stat_windows(uint64_t end_cycle) {
+    for (auto ch_idx = 0; ch_idx < _config.dram_channels; ++ch_idx) {
+        uint64_t from = _cycles;
+        while (from < end_cycle) {
+            // first skipped cycle that passes the current window
+            uint64_t lo = from;
+            uint64_t hi = end_cycle;
+            while (lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (_stats[ch_idx].back().start_cycle + _mem_cycle_interval < get_core_cycle(mid))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+            if (lo == end_cycle) break;
+            auto stat = MemoryIOStat((get_core_cycle(lo) / _mem_cycle_interval) * _mem_cycle_interval,
+                                     ch_idx, _mem_cycle_interval);
+            _stats[ch_idx].push_back(stat);
+            from = lo + 1;
+        }
+    }
+}
+
+cycle_type Interconnect::get_core_cycle(uint64_t icnt_cycle) {
+    return (cycle_type)((double)icnt_cycle * (double)Config::global_config.core_freq /
                         (double)Config::global_config.icnt_freq);
 }
 
-void Interconnect::update_stat(MemoryAccess memory_access, uint64_t ch_idx) {
+void Interconnect::update_stat(const MemoryAccess &memory_access, uint64_t ch_idx) {
     // READ, WRITE, GWRITE, COMP, READRES, P_HEADER, COMPS_READRES, SIZE
     switch (memory_access.req_type) {
         case MemoryAccessType::READ:
@@ -122,6 +150,30 @@ void SimpleInterconnect::cycle() {
     _cycles++;
 }
 
+// In-buffer entries only move once their finish_cycle is reached;
+// anything already in an out/memreq queue is picked up in this cycle.
+cycle_type SimpleInterconnect::cycles_to_next_event() {
+    for (auto &out_buffer : _out_buffers) {
+        if (!out_buffer.empty()) return 0;
+    }
+    for (uint32_t ch = 0; ch < _config.dram_channels; ch++) {
+        if (!_mem_req_queue1[ch].empty() || !_mem_req_queue2[ch].empty()) return 0;
+    }
+    cycle_type next_event = std::numeric_limits<cycle_type>::max();
+    for (auto &in_buffer : _in_buffers) {
+        if (!in_buffer.empty()) next_event = MIN(next_event, in_buffer.front().finish_cycle);
+    }
+    if (next_event == std::numeric_limits<cycle_type>::max()) return next_event;
+    return next_event > _cycles ? next_event - _cycles : 0;
+}
+
+void SimpleInterconnect::fast_forward(cycle_type cycles) {
+    uint64_t end_cycle = _cycles + cycles;
+    replay_stat_windows(end_cycle);
+    _rr_start = (_rr_start + cycles) % _n_nodes;
+    _cycles = end_cycle;
+}
+
 void SimpleInterconnect::push(uint32_t src, uint32_t dest, MemoryAccess *request) {
     // -- initialize entity
     SimpleInterconnect::Entity entity;
@@ -187,3 +239,246 @@ void SimpleInterconnect::memreq_pop2(uint32_t cid) {
     assert(has_memreq2(cid));
     _mem_req_queue2[cid].pop();
 }
+
+std::mutex Booksim2Interconnect::_booksim_mutex;
+
+Booksim2Interconnect::Booksim2Interconnect(SimulationConfig config)
+    : _booksim_lock(_booksim_mutex) {
+    _cycles = 0;
+    _config = config;
+    _n_nodes = config.num_cores * config.dram_channels + config.dram_channels;
+    _dram_offset = config.num_cores * config.dram_channels;
+    _n_booksim_nodes = config.num_cores + config.dram_channels;
+    _ctrl_size = 8;
+    _config_path = fs::path(__FILE__).parent_path().append(config.icnt_config_path).string();
+    spdlog::info("Initialize Booksim2Interconnect: {} routers, config {}", _n_booksim_nodes,
+                 _config_path);
+    _booksim = std::make_unique<booksim2::Interconnect>(_config_path, _n_booksim_nodes);
+
+    _mem_req_queue1.resize(config.dram_channels);  // for SA
+    _mem_req_queue2.resize(config.dram_channels);  // for PIM
+    _packets = 0;
+    _total_latency = 0;
+    _max_latency = 0;
+    _injection_stalls.resize(_n_booksim_nodes);
+
+    _mem_cycle_interval = 250;
+    _stats.resize(config.dram_channels);
+    for (size_t i = 0; i < config.dram_channels; ++i) {
+        _stats[i].push_back(MemoryIOStat(0, i, _mem_cycle_interval));
+    }
+}
+
+bool Booksim2Interconnect::running() { return !_in_flight.empty(); }
+
+void Booksim2Interconnect::cycle() {
+    _booksim->run();
+    _stalled_packets.clear();
+
+    // requests leave the network at their channel and wait there for the DRAM
+    for (uint32_t ch = 0; ch < _config.dram_channels; ch++) {
+        uint32_t node = _config.num_cores + ch;
+        while (!_booksim->is_empty(node, 0)) {
+            auto mem_req = (MemoryAccess *)_booksim->top(node, 0);
+            _booksim->pop(node, 0);
+            arrive(mem_req);
+            if (!_config.sub_batch_mode) {
+                // single buffer PIM (Newton) has a single batch
+                mem_req->stage_platform = StagePlatform::SA;
+            }
+            assert(mem_req->stage_platform == StagePlatform::SA ||
+                   mem_req->stage_platform == StagePlatform::PIM);
+            if (mem_req->stage_platform == StagePlatform::SA)
+                _mem_req_queue1[ch].push(mem_req);
+            else
+                _mem_req_queue2[ch].push(mem_req);
+        }
+    }
+
+    for (auto ch_idx = 0; ch_idx < _config.dram_channels; ++ch_idx) {
+        if (_stats[ch_idx].back().start_cycle + _mem_cycle_interval < get_core_cycle()) {
+            auto stat = MemoryIOStat((get_core_cycle() / _mem_cycle_interval) * _mem_cycle_interval,
+                                     ch_idx, _mem_cycle_interval);
+            _stats[ch_idx].push_back(stat);
+        }
+    }
+    _cycles++;
+}
+
+void Booksim2Interconnect::push(uint32_t src, uint32_t dest, MemoryAccess *request) {
+    uint32_t src_node = booksim_node(src);
+    uint32_t dest_node = booksim_node(dest);
+    uint32_t size = get_packet_size(request);
+    uint32_t channel = dest >= _dram_offset ? dest - _dram_offset : dest % _config.dram_channels;
+    _in_flight[request] = InFlight{.push_cycle = _cycles, .channel = channel};
+    _booksim->push(request, 0, 0, size, get_booksim_type(request), src_node, dest_node);
+}
+
+bool Booksim2Interconnect::is_full(uint32_t nid, MemoryAccess *request) {
+    uint32_t node = booksim_node(nid);
+    bool full = _booksim->is_full(node, 0, get_packet_size(request));
+    // the simulator polls a waiting packet more than once per cycle
+    if (full && _stalled_packets.insert(request).second) _injection_stalls[node]++;
+    return full;
+}
+
+// the (core, channel) ports of a core share its router, so any of them may take a response
+bool Booksim2Interconnect::is_empty(uint32_t nid) {
+    assert(nid < _dram_offset);
+    return _booksim->is_empty(booksim_node(nid), 0);
+}
+
+MemoryAccess *Booksim2Interconnect::top(uint32_t nid) {
+    assert(!is_empty(nid));
+    return (MemoryAccess *)_booksim->top(booksim_node(nid), 0);
+}
+
+void Booksim2Interconnect::pop(uint32_t nid) {
+    auto mem_access = top(nid);
+    update_stat(*mem_access, arrive(mem_access));
+    _booksim->pop(booksim_node(nid), 0);
+}
+
+void Booksim2Interconnect::print_stats() {
+    _booksim->print_stats();
+    log_link_stats();
+}
+
+bool Booksim2Interconnect::has_memreq1(uint32_t cid) { return !_mem_req_queue1[cid].empty(); }
+bool Booksim2Interconnect::has_memreq2(uint32_t cid) { return !_mem_req_queue2[cid].empty(); }
+
+MemoryAccess *Booksim2Interconnect::memreq_top1(uint32_t cid) {
+    assert(has_memreq1(cid));
+    return _mem_req_queue1[cid].front();
+}
+MemoryAccess *Booksim2Interconnect::memreq_top2(uint32_t cid) {
+    assert(has_memreq2(cid));
+    return _mem_req_queue2[cid].front();
+}
+
+void Booksim2Interconnect::memreq_pop1(uint32_t cid) {
+    assert(has_memreq1(cid));
+    _mem_req_queue1[cid].pop();
+}
+
+void Booksim2Interconnect::memreq_pop2(uint32_t cid) {
+    assert(has_memreq2(cid));
+    _mem_req_queue2[cid].pop();
+}
+
+// packets in the network, at an ejection port or in a memreq queue are handled in this cycle
+cycle_type Booksim2Interconnect::cycles_to_next_event() {
+    if (!_in_flight.empty() || _booksim->busy()) return 0;
+    for (uint32_t ch = 0; ch < _config.dram_channels; ch++) {
+        if (!_mem_req_queue1[ch].empty() || !_mem_req_queue2[ch].empty()) return 0;
+    }
+    return std::numeric_limits<cycle_type>::max();
+}
+
+// booksim2 is idle, its routers have nothing to step through
+void Booksim2Interconnect::fast_forward(cycle_type cycles) {
+    uint64_t end_cycle = _cycles + cycles;
+    replay_stat_windows(end_cycle);
+    _cycles = end_cycle;
+}
+
+booksim2::Interconnect::Type Booksim2Interconnect::get_booksim_type(MemoryAccess *access) {
+    bool write = access->req_type == MemoryAccessType::WRITE ||
+                 access->req_type == MemoryAccessType::GWRITE;
+    if (write)
+        return access->request ? booksim2::Interconnect::Type::WRITE
+                               : booksim2::Interconnect::Type::WRITE_REPLY;
+    return access->request ? booksim2::Interconnect::Type::READ
+                           : booksim2::Interconnect::Type::READ_REPLY;
+}
+
+// data travels with write requests and read replies, the rest is a control packet
+uint32_t Booksim2Interconnect::get_packet_size(MemoryAccess *access) {
+    bool write = access->req_type == MemoryAccessType::WRITE ||
+                 access->req_type == MemoryAccessType::GWRITE;
+    bool data = access->request == write;
+    return data ? access->size : _ctrl_size;
+}
+
+// cores first, then DRAM channels
+uint32_t Booksim2Interconnect::booksim_node(uint32_t nid) {
+    if (nid < _dram_offset) return nid / _config.dram_channels;
+    return _config.num_cores + nid - _dram_offset;
+}
+
+// records the latency of a packet that left the network, returns its DRAM channel
+uint32_t Booksim2Interconnect::arrive(MemoryAccess *access) {
+    auto it = _in_flight.find(access);
+    assert(it != _in_flight.end());
+    auto in_flight = it->second;
+    _in_flight.erase(it);
+
+    uint64_t latency = _cycles - in_flight.push_cycle;
+    _packets++;
+    _total_latency += latency;
+    _max_latency = MAX(_max_latency, latency);
+    return in_flight.channel;
+}
+
+// booksim2 numbers the terminals of injection and ejection links -1
+std::string Booksim2Interconnect::router_name(int node) {
+    if (node < 0) return "terminal";
+    if (node < _config.num_cores) return fmt::format("core{}", node);
+    return fmt::format("ch{}", node - _config.num_cores);
+}
+
+// booksim2 builds whose wrapper exports its network channels (get_channel_stats) report
+// contention per link, others only the injection stalls per router
+template <typename Booksim, typename = void>
+struct has_channel_stats : std::false_type {};
+template <typename Booksim>
+struct has_channel_stats<
+    Booksim, std::void_t<decltype(std::declval<const Booksim &>().get_channel_stats(0))>>
+    : std::true_type {};
+
+// Contention per network link: flits it carried, its utilization over the run and the cycles
+// flits waited at its input for it (no credit downstream or lost switch allocation).
+template <typename Booksim>
+static void write_link_stats(const Booksim &booksim, std::ofstream &ofile, uint64_t cycles,
+                             const std::vector<uint64_t> &injection_stalls,
+                             std::function<std::string(int)> router_name,
+                             uint64_t &link_stalls, double &max_utilization) {
+    if constexpr (has_channel_stats<Booksim>::value) {
+        ofile << "src\tdest\tflits\tutilization\tstall_cycles\n";
+        for (auto &link : booksim.get_channel_stats(0)) {
+            double utilization = cycles > 0 ? (double)link.flits / cycles : 0;
+            ofile << router_name(link.src_router) << "\t" << router_name(link.dest_router) << "\t"
+                  << link.flits << "\t" << utilization << "\t" << link.stall_cycles << "\n";
+            link_stalls += link.stall_cycles;
+            max_utilization = MAX(max_utilization, utilization);
+        }
+    } else {
+        spdlog::warn("booksim2 does not export its channels, logging injection stalls only");
+        ofile << "router\tinjection_stalls\n";
+        for (uint32_t node = 0; node < injection_stalls.size(); node++)
+            ofile << router_name(node) << "\t" << injection_stalls[node] << "\n";
+    }
+}
+
+void Booksim2Interconnect::log_link_stats() {
+    std::string fname = Config::global_config.log_dir + "/_icnt_links.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    uint64_t link_stalls = 0;
+    double max_utilization = 0;
+    write_link_stats(
+        *_booksim, ofile, _cycles, _injection_stalls,
+        [this](int node) { return router_name(node); }, link_stalls, max_utilization);
+    ofile.close();
+
+    uint64_t injection_stalls = 0;
+    for (auto node_stalls : _injection_stalls) injection_stalls += node_stalls;
+    if (_packets == 0) return;
+    spdlog::info(
+        "Booksim2: {} packets, avg latency {:.1f} (max {}) icnt cycles, busiest link {:.1f}% "
+        "utilized, {} link stall cycles, {} injection stalls",
+        _packets, (double)_total_latency / _packets, _max_latency, 100 * max_utilization,
+        link_stalls, injection_stalls);
+}
@@ -1,6 +1,7 @@
 #ifndef INTERCONNECT_H
 #define INTERCONNECT_H
 #include <list>
+#include <mutex>
 
 #include "Common.h"
 #include "Logger.h"
@@ -26,11 +27,18 @@ class Interconnect {
     virtual void memreq_pop1(uint32_t cid) = 0;
     virtual void memreq_pop2(uint32_t cid) = 0;
 
+    // event-driven fast-forward (see NeuPIMSCore::cycles_to_next_event)
+    virtual cycle_type cycles_to_next_event() { return 0; }
+    virtual void fast_forward(cycle_type) { assert(0); }
+
     void log(Stage stage);
-    void update_stat(MemoryAccess mem_access, uint64_t ch_idx);
+    void update_stat(const MemoryAccess &mem_access, uint64_t ch_idx);
     inline cycle_type get_core_cycle();
+    inline cycle_type get_core_cycle(uint64_t icnt_cycle);
 
    protected:
+    void replay_stat_windows(uint64_t end_cycle);
+
     SimulationConfig _config;
     uint32_t _n_nodes;
     uint32_t _dram_offset;
@@ -62,6 +70,9 @@ class SimpleInterconnect : public Interconnect {
     virtual void memreq_pop1(uint32_t cid) override;
     virtual void memreq_pop2(uint32_t cid) override;
 
+    virtual cycle_type cycles_to_next_event() override;
+    virtual void fast_forward(cycle_type cycles) override;
+
    private:
     uint32_t _latency;
     double _bandwidth;
@@ -84,6 +95,9 @@ class SimpleInterconnect : public Interconnect {
     std::vector<std::queue<MemoryAccess *>> _mem_req_queue2;
 };
 
+// Network simulated by booksim2 (mesh, crossbar, ... from icnt_config_path). The simulator's
+// per (core, channel) ports of a core share the core's router, every DRAM channel has its own.
+// booksim2 keeps its network in globals, so parallel sweep runs take turns on it (_booksim_lock).
 class Booksim2Interconnect : public Interconnect {
    public:
     Booksim2Interconnect(SimulationConfig config);
@@ -96,12 +110,46 @@ class Booksim2Interconnect : public Interconnect {
     virtual void pop(uint32_t nid) override;
     virtual void print_stats() override;
 
+    virtual bool has_memreq1(uint32_t cid) override;
+    virtual bool has_memreq2(uint32_t cid) override;
+    virtual MemoryAccess *memreq_top1(uint32_t cid) override;
+    virtual MemoryAccess *memreq_top2(uint32_t cid) override;
+    virtual void memreq_pop1(uint32_t cid) override;
+    virtual void memreq_pop2(uint32_t cid) override;
+
+    // booksim2 steps its routers every cycle, so only an empty network is skipped
+    virtual cycle_type cycles_to_next_event() override;
+    virtual void fast_forward(cycle_type cycles) override;
+
    private:
+    static std::mutex _booksim_mutex;
+    std::unique_lock<std::mutex> _booksim_lock;  // released after _booksim is destroyed
     uint32_t _ctrl_size;
     std::string _config_path;
     std::unique_ptr<booksim2::Interconnect> _booksim;
+    uint32_t _n_booksim_nodes;
 
     booksim2::Interconnect::Type get_booksim_type(MemoryAccess *access);
     uint32_t get_packet_size(MemoryAccess *access);
+    uint32_t booksim_node(uint32_t nid);
+
+    // memory requests that arrived at a channel, by sub-batch
+    std::vector<std::queue<MemoryAccess *>> _mem_req_queue1;
+    std::vector<std::queue<MemoryAccess *>> _mem_req_queue2;
+
+    // packet latencies in icnt cycles, per link contention is read from booksim2's channels
+    struct InFlight {
+        uint64_t push_cycle;
+        uint32_t channel;
+    };
+    uint64_t _packets;
+    uint64_t _total_latency;
+    uint64_t _max_latency;
+    std::vector<uint64_t> _injection_stalls;  // per source router, packets refused per cycle
+    robin_hood::unordered_set<MemoryAccess *> _stalled_packets;  // refused in this cycle
+    robin_hood::unordered_map<MemoryAccess *, InFlight> _in_flight;
+    uint32_t arrive(MemoryAccess *access);
+    std::string router_name(int node);
+    void log_link_stats();
 };
 #endif
\ No newline at end of file
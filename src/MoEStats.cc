@@ -2,7 +2,7 @@
 
 namespace MoEStats {
 
-std::vector<MoELayerStat> layer_stats;
+thread_local std::vector<MoELayerStat> layer_stats;
 
 void init() {
     layer_stats.clear();
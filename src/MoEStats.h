@@ -39,7 +39,7 @@ struct MoELayerStat {
 };
 
 // Global MoE stats collector
-extern std::vector<MoELayerStat> layer_stats;
+extern thread_local std::vector<MoELayerStat> layer_stats;
 
 void init();
 void record_router_completion(std::string layer_name, uint64_t cycles);
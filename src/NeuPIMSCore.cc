@@ -113,6 +113,10 @@ void NeuPIMSCore::issue(Tile &in_tile) {
     tile->remaining_loads = 0;
     tile->remaining_computes = 0;
     tile->remaining_accum_io = 0;
+    if (tile->analytical_cycles > 0) {
+        issue_analytical(tile);
+        return;
+    }
     for (auto &inst : tile->instructions) {
         inst.parent_tile = std::weak_ptr<Tile>(tile);
         inst.spad_id = tile->spad_id;
@@ -167,6 +171,29 @@ void NeuPIMSCore::issue(Tile &in_tile) {
     _tiles.push_back(tile);
 }
 
+// A single GEMM that occupies the systolic array once the running ones drain, so compute stats
+// and fast-forward treat it like any other. Its size makes GEMMs issued behind it wait for it.
+void NeuPIMSCore::issue_analytical(Ptr<Tile> tile) {
+    Instruction inst{
+        .opcode = Opcode::GEMM,
+        .dest_addr = ACCUM_SPAD_BASE,
+        .size = (uint32_t)tile->analytical_cycles,
+    };
+    inst.parent_tile = std::weak_ptr<Tile>(tile);
+    inst.spad_id = tile->spad_id;
+    inst.accum_spad_id = tile->accum_spad_id;
+    inst.start_cycle = _compute_pipeline.empty()
+                           ? _core_cycle
+                           : MAX(_core_cycle, _compute_pipeline.back().finish_cycle);
+    inst.finish_cycle = inst.start_cycle + tile->analytical_cycles;
+    _acc_spad.reserve(inst.dest_addr, inst.accum_spad_id, 0, 1);
+
+    tile->remaining_computes = 1;
+    tile->remaining_accum_io = 1;
+    _compute_pipeline.push(inst);
+    _tiles.push_back(tile);
+}
+
 void NeuPIMSCore::issue_pim(Tile &in_tile) {
     spdlog::info("pim tile issued {}", in_tile.repr());
     auto tile = std::make_shared<Tile>(in_tile);
@@ -264,7 +291,7 @@ void NeuPIMSCore::cycle() {
         //     tile_it - _tiles.begin(), tile->remaining_accum_io, tile->remaining_computes,
         //     tile->remaining_loads);
         if ((tile->remaining_accum_io == 0) && (tile->remaining_computes == 0) &&
-            (tile->remaining_loads == 0)) {
+            (tile->remaining_loads == 0) && (tile->inflight_accesses == 0)) {
             tile->status = Tile::Status::FINISH;
             _finished_tiles.push(tile);
             tile_it = _tiles.erase(tile_it);
@@ -277,7 +304,7 @@ void NeuPIMSCore::cycle() {
         // spdlog::info("tile remain_accum_io: {}, remain_computes: {}, remain_loads: {}",
         //              tile->remaining_accum_io, tile->remaining_computes, tile->remaining_loads);
         if ((tile->remaining_accum_io == 0) && (tile->remaining_computes == 0) &&
-            (tile->remaining_loads == 0)) {
+            (tile->remaining_loads == 0) && (tile->inflight_accesses == 0)) {
             tile->status = Tile::Status::FINISH;
             _finished_tiles.push(tile);
             tile_it = _pim_tiles.erase(tile_it);
@@ -288,6 +315,61 @@ void NeuPIMSCore::cycle() {
     // xxx : need logic for _finished_pim_tiles?
 }
 
+// Only the head of each pipeline is retired per cycle, so the earliest head finish_cycle is the
+// next event as long as no queue can make progress on its own in the meantime.
+cycle_type NeuPIMSCore::cycles_to_next_event() {
+    if (!_finished_tiles.empty() || !_ld_inst_queue_for_sa.empty() ||
+        !_ld_inst_queue_for_pim.empty()) {
+        return 0;
+    }
+    for (uint32_t ch = 0; ch < _config.dram_channels; ch++) {
+        if (!_memory_request_queues1[ch].empty() || !_memory_request_queues2[ch].empty()) {
+            return 0;
+        }
+    }
+    for (auto &tiles : {&_tiles, &_pim_tiles}) {
+        for (auto &tile : *tiles) {
+            if ((tile->remaining_accum_io == 0) && (tile->remaining_computes == 0) &&
+                (tile->remaining_loads == 0)) {
+                return 0;
+            }
+        }
+    }
+    if (!_st_inst_queue_for_sa.empty()) {
+        Instruction &front = _st_inst_queue_for_sa.front();
+        Sram *buffer = front.dest_addr >= ACCUM_SPAD_BASE ? &_acc_spad : &_spad;
+        int buffer_id = front.dest_addr >= ACCUM_SPAD_BASE ? front.accum_spad_id : front.spad_id;
+        if (buffer->check_hit(front.dest_addr, buffer_id)) return 0;
+    }
+    if (!_st_inst_queue_for_pim.empty()) {
+        Instruction &front = _st_inst_queue_for_pim.front();
+        Sram *buffer = front.dest_addr >= ACCUM_SPAD_BASE ? &_pim_acc_spad : &_pim_spad;
+        int buffer_id = front.dest_addr >= ACCUM_SPAD_BASE ? front.accum_spad_id : front.spad_id;
+        if (buffer->check_hit(front.dest_addr, buffer_id)) return 0;
+    }
+    if (!_ex_inst_queue_for_sa.empty() && can_issue_compute(_ex_inst_queue_for_sa.front())) {
+        return 0;
+    }
+    if (!_ex_inst_queue_for_pim.empty() &&
+        pim_can_issue_compute(_ex_inst_queue_for_pim.front())) {
+        return 0;
+    }
+
+    cycle_type next_event = std::numeric_limits<cycle_type>::max();
+    if (!_compute_pipeline.empty()) {
+        next_event = MIN(next_event, _compute_pipeline.front().finish_cycle);
+    }
+    for (auto &vector_pipeline : _vector_pipelines) {
+        if (!vector_pipeline.empty()) {
+            next_event = MIN(next_event, vector_pipeline.front().finish_cycle);
+        }
+    }
+    if (next_event == std::numeric_limits<cycle_type>::max()) return next_event;
+    return next_event > _core_cycle ? next_event - _core_cycle : 0;
+}
+
+void NeuPIMSCore::fast_forward(cycle_type cycles) { _core_cycle += cycles; }
+
 bool NeuPIMSCore::running() {
     bool running = false;
     running = running || _tiles.size() > 0;
@@ -338,7 +420,7 @@ void NeuPIMSCore::push_memory_response(MemoryAccess *response) {
     Sram *acc_spad = &_acc_spad;
     Sram *spad = &_spad;
     uint32_t buf_id;
-    if (auto parent = response->parent_tile.lock()) {
+    if (auto parent = response->parent_tile) {
         if (parent->stage_platform == StagePlatform::PIM) {
             spad = &_pim_spad;
             acc_spad = &_pim_acc_spad;
@@ -347,7 +429,9 @@ void NeuPIMSCore::push_memory_response(MemoryAccess *response) {
 
     bool is_write = response->req_type == MemoryAccessType::WRITE;
     bool is_read = response->req_type == MemoryAccessType::READ;
-    if (auto tile = response->parent_tile.lock()) {
+    if (auto tile = response->parent_tile) {
+        assert(tile->inflight_accesses > 0);
+        tile->inflight_accesses--;
         if (is_write) {
             tile->remaining_accum_io--;
         } else {
@@ -375,7 +459,7 @@ void NeuPIMSCore::push_memory_response(MemoryAccess *response) {
         // case3: load activation or weight to _spad
         spad->fill(response->spad_address, response->buffer_id);
     }
-    delete response;
+    MemoryAccess::release(response);
 }
 
 // -- seems it is not used.
@@ -384,7 +468,9 @@ void NeuPIMSCore::pim_push_memory_response(MemoryAccess *response) {
 
     bool is_write = response->req_type == MemoryAccessType::WRITE;
     bool is_read = response->req_type == MemoryAccessType::READ;
-    if (auto tile = response->parent_tile.lock()) {
+    if (auto tile = response->parent_tile) {
+        assert(tile->inflight_accesses > 0);
+        tile->inflight_accesses--;
         if (is_write) {
             tile->remaining_accum_io--;
         } else {
@@ -412,7 +498,7 @@ void NeuPIMSCore::pim_push_memory_response(MemoryAccess *response) {
         // case3: load activation or weight to _spad
         _pim_spad.fill(response->spad_address, response->buffer_id);
     }
-    delete response;
+    MemoryAccess::release(response);
 }
 
 // checks if inputs are loaded.
@@ -25,6 +25,11 @@ class NeuPIMSCore {
 
     virtual void cycle();
 
+    // event-driven fast-forward
+    // 0: state may change in this cycle, max: nothing scheduled (waiting for memory responses)
+    virtual cycle_type cycles_to_next_event();
+    virtual void fast_forward(cycle_type cycles);
+
     // add index to each methods
     virtual bool has_memory_request1(uint32_t index) {
         return _memory_request_queues1[index].size() > 0;
@@ -57,6 +62,7 @@ class NeuPIMSCore {
    protected:
     virtual bool can_issue_compute(Instruction &inst);
     virtual bool pim_can_issue_compute(Instruction &inst);
+    void issue_analytical(Ptr<Tile> tile);
     virtual cycle_type get_inst_compute_cycles(Instruction &inst) = 0;
 
     const uint32_t _id;
@@ -34,6 +34,21 @@ void NeuPIMSystolicWS::cycle() {
     NeuPIMSCore::cycle();
 }
 
+// Nothing but the stat counters change while idle, so replay them in bulk,
+// one utilization window at a time.
+void NeuPIMSystolicWS::fast_forward(cycle_type cycles) {
+    cycle_type end_cycle = _core_cycle + cycles;
+    while (_core_cycle < end_cycle) {
+        if (_stat.back().start_cycle + 1000 < _core_cycle) {
+            auto stat = NPUStat(_core_cycle);
+            _stat.push_back(stat);
+        }
+        cycle_type span = MIN(end_cycle, _stat.back().start_cycle + 1001) - _core_cycle;
+        update_stats(span);
+        NeuPIMSCore::fast_forward(span);
+    }
+}
+
 void NeuPIMSystolicWS::systolic_cycle() {
     /* Compute unit */
     if (!_compute_pipeline.empty() && _compute_pipeline.front().finish_cycle <= _core_cycle) {
@@ -107,7 +122,7 @@ void NeuPIMSystolicWS::ld_queue_cycle() {
                 buffer_id = front.spad_id;
             }
 
-            ast(!front.src_addrs.empty());
+            ast(!front.src_ranges.empty());
 
             auto accesses = MemoryAccess::from_instruction(
                 front, generate_mem_access_id(), _config.dram_req_size, MemoryAccessType::READ,
@@ -296,15 +311,15 @@ void NeuPIMSystolicWS::pim_ex_queue_cycle() {
     }
 }
 
-void NeuPIMSystolicWS::update_stats() {
+void NeuPIMSystolicWS::update_stats(cycle_type cycles) {
     if (!_compute_pipeline.empty()) {
         auto parent_tile = _compute_pipeline.front().parent_tile.lock();
         if (parent_tile == nullptr) {
             assert(0);
         }
-        parent_tile->stat.compute_cycles++;
+        parent_tile->stat.compute_cycles += cycles;
         // Systolic array throughput per cycle = width × height × 2 (MAC operations)
-        _stat.back().num_calculations += _config.core_width * _config.core_height * 2;
+        _stat.back().num_calculations += _config.core_width * _config.core_height * 2 * cycles;
     }
     for (auto &vector_pipeline : _vector_pipelines) {
         if (!vector_pipeline.empty()) {
@@ -312,9 +327,9 @@ void NeuPIMSystolicWS::update_stats() {
             if (parent_tile == nullptr) {
                 assert(0);
             }
-            parent_tile->stat.compute_cycles++;
+            parent_tile->stat.compute_cycles += cycles;
             // Vector unit throughput per cycle = vector_core_width
-            _stat.back().num_calculations += _config.vector_core_width;
+            _stat.back().num_calculations += _config.vector_core_width * cycles;
         }
     }
 
@@ -324,56 +339,56 @@ void NeuPIMSystolicWS::update_stats() {
         is_idle = is_idle && vector_pipeline.empty();
     }
     if (is_idle) {
-        _stat_memory_cycle++;
+        _stat_memory_cycle += cycles;
 
         if (_ex_inst_queue_for_sa.empty()) {
-            _store_memory_cycle++;
+            _store_memory_cycle += cycles;
         } else {
-            _load_memory_cycle++;
+            _load_memory_cycle += cycles;
             switch (_ex_inst_queue_for_sa.front().opcode) {
                 case Opcode::GEMM:
                 case Opcode::GEMM_PRELOAD:
-                    _compute_memory_stall_cycle++;
+                    _compute_memory_stall_cycle += cycles;
                     break;
                 case Opcode::LAYERNORM:
-                    _layernorm_stall_cycle++;
+                    _layernorm_stall_cycle += cycles;
                     break;
                 case Opcode::SOFTMAX:
-                    _softmax_stall_cycle++;
+                    _softmax_stall_cycle += cycles;
                     break;
                 case Opcode::ADD:
-                    _add_stall_cycle++;
+                    _add_stall_cycle += cycles;
                     break;
                 case Opcode::GELU:
-                    _gelu_stall_cycle++;
+                    _gelu_stall_cycle += cycles;
                     break;
             }
         }
     } else if (!_compute_pipeline.empty()) {
-        _stat_matmul_cycle++;
+        _stat_matmul_cycle += cycles;
     } else {
         // } else if (!_vector_pipeline.empty()) {
         // when element in vector pipeline
         for (auto &vector_pipeline : _vector_pipelines) {
             switch (vector_pipeline.front().opcode) {
                 case Opcode::LAYERNORM:
-                    _stat_layernorm_cycle++;
+                    _stat_layernorm_cycle += cycles;
                     break;
                 case Opcode::SOFTMAX:
-                    _stat_softmax_cycle++;
+                    _stat_softmax_cycle += cycles;
                     break;
                 case Opcode::ADD:
-                    _stat_add_cycle++;
+                    _stat_add_cycle += cycles;
                     break;
                 case Opcode::GELU:
-                    _stat_gelu_cycle++;
+                    _stat_gelu_cycle += cycles;
                     break;
             }
         }
     }
 
     if (!running()) {
-        _stat_idle_cycle++;
+        _stat_idle_cycle += cycles;
     }
 }
 
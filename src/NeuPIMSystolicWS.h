@@ -4,6 +4,7 @@ class NeuPIMSystolicWS : public NeuPIMSCore {
    public:
     NeuPIMSystolicWS(uint32_t id, SimulationConfig config);
     virtual void cycle() override;
+    virtual void fast_forward(cycle_type cycles) override;
     virtual void print_stats() override;
     virtual void log() override;
 
@@ -35,5 +36,5 @@ class NeuPIMSystolicWS : public NeuPIMSCore {
     void pim_ex_queue_cycle();
 
     // Update stats
-    void update_stats();
+    void update_stats(cycle_type cycles = 1);
 };
\ No newline at end of file
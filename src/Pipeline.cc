@@ -0,0 +1,97 @@
+#include "Pipeline.h"
+
+Pipeline::Pipeline(SimulationConfig config) : _config(config) {
+    ast(_config.model_n_layer >= _config.n_pp);
+    for (uint32_t device = 0; device < _config.n_pp; device++) {
+        uint32_t layers = _config.model_n_layer / _config.n_pp;
+        if (device < _config.model_n_layer % _config.n_pp) layers++;
+        _device_layers.push_back(layers);
+    }
+}
+
+void Pipeline::add_stage_run(uint32_t layers, uint32_t micro_batch, double cycles,
+                             uint32_t iterations, uint32_t requests) {
+    _stage_runs[std::make_pair(layers, micro_batch)] =
+        StageRun{.cycles = cycles, .iterations = std::max(1u, iterations), .requests = requests};
+}
+
+cycle_type Pipeline::transfer(Resource &link, cycle_type ready, uint64_t bytes) {
+    double bytes_per_cycle = (double)_config.pp_link_bandwidth_gbps * 1e3 / _config.core_freq;
+    cycle_type cycles = std::ceil(bytes / bytes_per_cycle);
+    cycle_type start = std::max(ready, link.free_cycle);
+    link.free_cycle = start + cycles;
+    link.busy_cycles += cycles;
+    link.bytes += bytes;
+    return link.free_cycle + _config.pp_link_latency;
+}
+
+// Iteration by iteration, micro-batches enter the first device in order and every resource
+// serves them first come first served. An iteration of a micro-batch starts once its tokens of
+// the previous iteration are back from the last device.
+void Pipeline::schedule(std::string log_dir) {
+    uint32_t n_devices = _device_layers.size();
+    std::vector<Resource> devices;
+    std::vector<Resource> links;  // links[d]: device d -> d + 1, the last one goes back to 0
+    for (uint32_t device = 0; device < n_devices; device++) {
+        devices.push_back(Resource{.name = fmt::format("device{}", device),
+                                   .layers = _device_layers[device]});
+        links.push_back(Resource{
+            .name = fmt::format("link{}-{}", device, (device + 1) % n_devices), .layers = 0});
+    }
+
+    uint32_t max_iterations = 0;
+    for (auto &[key, run] : _stage_runs) max_iterations = std::max(max_iterations, run.iterations);
+    std::vector<cycle_type> tokens_ready(_config.pp_micro_batches, 0);
+    cycle_type makespan = 0;
+    for (uint32_t iteration = 0; iteration < max_iterations; iteration++) {
+        for (uint32_t micro_batch = 0; micro_batch < _config.pp_micro_batches; micro_batch++) {
+            cycle_type ready = tokens_ready[micro_batch];
+            uint32_t requests = 0;
+            for (uint32_t device = 0; device < n_devices; device++) {
+                auto &run = _stage_runs.at(std::make_pair(_device_layers[device], micro_batch));
+                if (iteration >= run.iterations) break;
+                requests = run.requests;
+                Resource &stage = devices[device];
+                cycle_type cycles = std::ceil(run.cycles / run.iterations);
+                stage.free_cycle = std::max(ready, stage.free_cycle) + cycles;
+                stage.busy_cycles += cycles;
+
+                // activations of one token per request, then the sampled token ids
+                uint64_t bytes = device + 1 < n_devices
+                                     ? (uint64_t)requests * _config.model_n_embd * _config.precision
+                                     : (uint64_t)requests * sizeof(uint32_t);
+                ready = transfer(links[device], stage.free_cycle, bytes);
+                makespan = std::max(makespan, stage.free_cycle);
+            }
+            if (requests > 0) tokens_ready[micro_batch] = ready;
+        }
+    }
+
+    std::string fname = log_dir + "/_pipeline.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "resource\tlayers\tbusy_cycles\tutilization\tbytes\n";
+    cycle_type busy_cycles = 0;
+    uint64_t link_bytes = 0;
+    for (auto &resources : {devices, links}) {
+        for (auto &resource : resources) {
+            double utilization = makespan > 0 ? (double)resource.busy_cycles / makespan : 0;
+            ofile << resource.name << "\t" << resource.layers << "\t" << resource.busy_cycles
+                  << "\t" << utilization << "\t" << resource.bytes << "\n";
+        }
+    }
+    for (auto &device : devices) busy_cycles += device.busy_cycles;
+    for (auto &link : links) link_bytes += link.bytes;
+    double bubble = makespan > 0 ? 1 - (double)busy_cycles / (n_devices * makespan) : 0;
+    ofile << "pipeline\t" << _config.model_n_layer << "\t" << makespan << "\t" << 1 - bubble
+          << "\t" << link_bytes << "\n";
+    ofile.close();
+
+    double link_seconds = (double)makespan / (_config.core_freq * 1e6);
+    spdlog::info("Pipeline: {} devices, {} micro-batches, {} cycles, bubble {:.1f}%", n_devices,
+                 _config.pp_micro_batches, makespan, bubble * 100);
+    spdlog::info("Pipeline links: {} bytes, {:.2f} GB/s average per link", link_bytes,
+                 link_seconds > 0 ? link_bytes / link_seconds / n_devices / 1e9 : 0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Common.h"
+
+// Pipeline-parallel deployment (pipeline_parallel): n_pp devices, each an NPU with its PIM stack
+// holding a consecutive slice of the layers. Every slice is simulated for every micro-batch on
+// its own (run_pipeline in main.cc), then each decode iteration of every micro-batch is passed
+// through the devices. A device works on one micro-batch at a time and a link carries one
+// transfer at a time: the activations of the micro-batch to the next device, and the sampled
+// tokens from the last device back to the first for the next iteration.
+class Pipeline {
+   public:
+    Pipeline(SimulationConfig config);
+
+    // layers held by every device, the first model_n_layer % n_pp devices hold one more
+    std::vector<uint32_t> device_layers() { return _device_layers; }
+    // result of the run simulating `layers` layers for micro_batch
+    void add_stage_run(uint32_t layers, uint32_t micro_batch, double cycles, uint32_t iterations,
+                       uint32_t requests);
+    void schedule(std::string log_dir);
+
+   private:
+    struct StageRun {
+        double cycles;  // all iterations
+        uint32_t iterations;
+        uint32_t requests;
+    };
+    struct Resource {
+        std::string name;
+        uint32_t layers;
+        cycle_type free_cycle;
+        cycle_type busy_cycles;
+        uint64_t bytes;
+    };
+
+    SimulationConfig _config;
+    std::vector<uint32_t> _device_layers;
+    std::map<std::pair<uint32_t, uint32_t>, StageRun> _stage_runs;  // (layers, micro_batch) ->
+
+    cycle_type transfer(Resource &link, cycle_type ready, uint64_t bytes);
+};
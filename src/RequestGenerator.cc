@@ -1,55 +1,197 @@
 #include "RequestGenerator.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
 namespace RequestGenerator {
-uint32_t answer_index;
-uint32_t row_index;
-std::vector<std::string> columns;
-std::vector<std::vector<uint32_t>> table;
+thread_local uint32_t answer_index;
+thread_local uint32_t row_index;
+thread_local int output_len_index;
+thread_local int arrival_us_index;
+thread_local int prefix_hash_index;
+thread_local int prefix_len_index;
+thread_local std::vector<std::string> columns;
+
+namespace {
+const char binary_magic[] = "NPTRACE1";
+const size_t binary_name_size = 32;
+
+struct MappedTrace {
+    const char *data = nullptr;
+    size_t size = 0;
+    ~MappedTrace() { unmap(); }
+    void unmap() {
+        if (data != nullptr) munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+};
+
+thread_local MappedTrace trace;
+thread_local bool binary;
+thread_local const char *rows_begin;  // first row after the header
+thread_local const char *cursor;      // csv: next row to decode
+thread_local uint32_t cursor_row;     // csv: index of the row at cursor
+thread_local uint32_t total_rows;
+thread_local uint32_t stride;
+thread_local std::vector<uint32_t> row;       // last returned by get_qa_length
+thread_local std::vector<uint32_t> next_row;  // decoded ahead, row row_index
+
+const char *trace_end() { return trace.data + trace.size; }
+
+const char *find_eol(const char *p) {
+    auto eol = (const char *)memchr(p, '\n', trace_end() - p);
+    return eol != nullptr ? eol : trace_end();
+}
+
+const char *skip_blank_lines(const char *p) {
+    while (p < trace_end() && (*p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+uint32_t parse_uint(const char *&p, const char *end) {
+    uint32_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    return value;
+}
+
+void decode_row(uint32_t index, std::vector<uint32_t> &out) {
+    out.clear();
+    if (binary) {
+        const char *p = rows_begin + (size_t)index * columns.size() * sizeof(uint32_t);
+        out.resize(columns.size());
+        memcpy(out.data(), p, columns.size() * sizeof(uint32_t));
+        return;
+    }
+    // csv rows are only ever decoded in order, rows in between are skipped
+    for (; cursor_row < index; cursor_row++) cursor = skip_blank_lines(find_eol(cursor));
+    const char *eol = find_eol(cursor);
+    while (cursor < eol) {
+        out.push_back(parse_uint(cursor, eol));
+        while (cursor < eol && *cursor != ',') cursor++;  // '\r' or garbage
+        if (cursor < eol) cursor++;
+    }
+    cursor = skip_blank_lines(eol);
+    cursor_row++;
+}
+
+void parse_csv_header() {
+    const char *eol = find_eol(trace.data);
+    std::string line(trace.data, eol);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::istringstream iss(line);
+    std::string column_name;
+    while (std::getline(iss, column_name, ',')) {
+        columns.push_back(column_name);
+    }
+
+    rows_begin = skip_blank_lines(eol);
+    total_rows = 0;
+    for (const char *p = rows_begin; p < trace_end(); p = skip_blank_lines(find_eol(p))) {
+        total_rows++;
+    }
+}
+
+void parse_binary_header() {
+    uint32_t n_columns;
+    const char *p = trace.data + strlen(binary_magic);
+    memcpy(&n_columns, p, sizeof(uint32_t));
+    memcpy(&total_rows, p + sizeof(uint32_t), sizeof(uint32_t));
+    p += 2 * sizeof(uint32_t);
+    for (uint32_t i = 0; i < n_columns; i++, p += binary_name_size) {
+        columns.push_back(std::string(p, strnlen(p, binary_name_size)));
+    }
+    rows_begin = p;
+    ast(rows_begin + (size_t)total_rows * n_columns * sizeof(uint32_t) <= trace_end());
+}
+}  // namespace
 
-void init(std::string path, uint32_t _answer_index) {
-    row_index = 0;
+void init(std::string path, uint32_t _answer_index, uint32_t row_offset, uint32_t row_stride) {
+    row_index = row_offset;
+    stride = std::max(1u, row_stride);
 
     // todo
     // initialize answer_index depending on the file type
     answer_index = _answer_index;
 
     parse(path);
-    spdlog::info("parsed {} lines from file {}", table.size(), path);
+    spdlog::info("parsed {} lines from file {}", total_rows, path);
+
+    auto it = std::find(columns.begin(), columns.end(), "output_len");
+    output_len_index = it != columns.end() ? it - columns.begin() : -1;
+    it = std::find(columns.begin(), columns.end(), "arrival_us");
+    arrival_us_index = it != columns.end() ? it - columns.begin() : -1;
+    it = std::find(columns.begin(), columns.end(), "prefix_hash");
+    prefix_hash_index = it != columns.end() ? it - columns.begin() : -1;
+    it = std::find(columns.begin(), columns.end(), "prefix_len");
+    prefix_len_index = it != columns.end() ? it - columns.begin() : -1;
+
+    if (has_data()) decode_row(row_index, next_row);
+}
+int get_total_req_cnt() {
+    uint32_t offset = row_index % stride;  // before the first get_qa_length
+    return total_rows > offset ? (total_rows - offset + stride - 1) / stride : 0;
 }
-int get_total_req_cnt() { return table.size(); }
 
-bool has_data() { return row_index < table.size(); }
+bool has_data() { return row_index < total_rows; }
 
 std::pair<uint32_t, uint32_t> get_qa_length() {
     ast(has_data());
-    auto row = table[row_index++];
+    std::swap(row, next_row);
+    row_index += stride;
+    if (row_index < total_rows) decode_row(row_index, next_row);
     return std::make_pair(row[0], row[answer_index]);
 }
 
+uint32_t get_output_len() {
+    if (output_len_index < 0) return 1;
+    return std::max(1u, row[output_len_index]);
+}
+
+uint32_t peek_arrival_us() {
+    ast(has_data());
+    if (arrival_us_index < 0) return 0;
+    return next_row[arrival_us_index];
+}
+
+std::pair<uint32_t, uint32_t> get_prefix() {
+    if (prefix_hash_index < 0 || prefix_len_index < 0) return std::make_pair(0, 0);
+    return std::make_pair(row[prefix_hash_index], row[prefix_len_index]);
+}
+
+// maps the trace and reads its header, rows are decoded by get_qa_length
 void parse(std::string path) {
-    std::ifstream input_file(path);
-    if (!input_file.is_open()) {
+    trace.unmap();
+    columns.clear();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
         std::cout << path << std::endl;
         assert(0);
     }
-
-    std::string line;
-    if (std::getline(input_file, line)) {
-        std::istringstream iss(line);
-        std::string column_name;
-        while (std::getline(iss, column_name, ',')) {
-            columns.push_back(column_name);
-        }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cout << path << std::endl;
+        assert(0);
     }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    trace.data = (const char *)data;
+    trace.size = st.st_size;
 
-    while (std::getline(input_file, line)) {
-        std::vector<uint32_t> buffer;
-        std::istringstream iss(line);
-        std::string cell;
-        while (std::getline(iss, cell, ',')) {
-            buffer.push_back(std::stoul(cell));
-        }
-        table.push_back(buffer);
-    }
+    size_t magic_size = strlen(binary_magic);
+    binary = trace.size >= magic_size + 2 * sizeof(uint32_t) &&
+             memcmp(trace.data, binary_magic, magic_size) == 0;
+    if (binary)
+        parse_binary_header();
+    else
+        parse_csv_header();
+    cursor = rows_begin;
+    cursor_row = 0;
 }
-}  // namespace RequestGenerator
\ No newline at end of file
+}  // namespace RequestGenerator
@@ -1,14 +1,30 @@
+#pragma once
 #include "Common.h"
 
+// Request trace reader. The trace file is mmapped and rows are decoded on demand, so traces
+// with millions of rows cost neither parse time at startup nor memory per row.
+//
+// Two formats are accepted:
+// - csv: header line of column names, one row of unsigned integers per line
+// - binary (trace-generator/csv_to_trace_bin.py): "NPTRACE1", uint32 n_columns, uint32 n_rows,
+//   n_columns 32-byte zero padded column names, then n_rows * n_columns uint32 (little endian)
 namespace RequestGenerator {
-extern uint32_t answer_index;
-extern uint32_t row_index;
-extern std::vector<std::string> columns;
-extern std::vector<std::vector<uint32_t>> table;
+extern thread_local uint32_t answer_index;
+extern thread_local uint32_t row_index;
+extern thread_local int output_len_index;  // "output_len" column, -1 if the trace has none
+extern thread_local int arrival_us_index;  // "arrival_us" column, -1 if the trace has none
+extern thread_local int prefix_hash_index;  // "prefix_hash" column, -1 if the trace has none
+extern thread_local int prefix_len_index;   // "prefix_len" column, -1 if the trace has none
+extern thread_local std::vector<std::string> columns;
 
-void init(std::string path, uint32_t _answer_index);
+// only rows row_offset + k * row_stride are returned (pipeline micro-batches)
+void init(std::string path, uint32_t _answer_index, uint32_t row_offset = 0,
+          uint32_t row_stride = 1);
 bool has_data();
 std::pair<uint32_t, uint32_t> get_qa_length();
+uint32_t get_output_len();  // of the row last returned by get_qa_length, 1 without the column
+uint32_t peek_arrival_us();  // of the row returned next by get_qa_length, 0 without the column
+std::pair<uint32_t, uint32_t> get_prefix();  // (hash, length) of the last row, 0s without columns
 int get_total_req_cnt();
 void parse(std::string path);
 }  // namespace RequestGenerator
@@ -15,6 +15,16 @@ enum class IcntType { SIMPLE, BOOKSIM2 };
 
 enum class RunMode { NPU_ONLY, NPU_PIM };
 
+enum class LayerSimMode { SINGLE, FULL, SAMPLED };
+
+enum class ArrivalMode { BATCH, POISSON, GAMMA, TRACE };
+
+enum class KVPreemption { RECOMPUTE, SWAP };
+
+enum class SubBatchPartition { SIMPLE, DP, BALANCED };
+
+enum class StageSchedule { STATIC, DYNAMIC };
+
 struct SimulationConfig {
     // gpt model config
     std::string model_name;
@@ -46,11 +56,38 @@ struct SimulationConfig {
     /* Custom Config */
     RunMode run_mode;  // NPU
     bool sub_batch_mode;
+    SubBatchPartition sub_batch_partition;  // how a channel's requests are split in sub-batches
+    uint32_t sub_batches;                   // sub-batches interleaved in sub_batch_mode
+    StageSchedule stage_schedule;           // what SA and PIM run in each stage
     bool ch_load_balancing;
+    bool online_ch_balancing;  // the scheduler places requests instead of the trace channel
     bool kernel_fusion;
     uint32_t max_batch_size;
     uint32_t max_active_reqs;  // max size of (ready_queue + running_queue) in scheduler
     uint32_t max_seq_len;
+    bool fast_forward;  // skip idle core/icnt cycles up to the next event
+    bool real_addresses;  // DRAM accesses use tensor addresses instead of a synthetic stream
+    uint32_t tile_lookahead;  // tiles of the running operation built ahead of the cores
+    uint32_t tile_cache_tiles;  // capacity of the TileCache, 0: off
+    bool analytical_gemm;              // cost weight GEMMs with the calibrated GemmModel
+    uint32_t analytical_gemm_samples;  // cycle-accurate runs per weight shape before that
+    bool tp_row_parallel;  // split projection/FC2 over cores by K and all-reduce the partial sums
+    LayerSimMode layer_sim_mode;  // decoder layers simulated per iteration
+    uint32_t sampled_layers;      // layers simulated in LayerSimMode::SAMPLED
+    bool multi_iteration;         // decode until each request reaches its output length
+    std::string checkpoint_stage;  // fork continuations when this stage starts
+    json checkpoint_continuations;  // [{"log_dir", optional "sys_config"}]
+    uint32_t slo_ttft_cycles;  // request SLO on time to first token, 0: none
+    uint32_t slo_tpot_cycles;  // request SLO on time per output token, 0: none
+    uint32_t kv_rows_per_channel;  // PIM rows per channel for KV caches, 0: all free rows
+    KVPreemption kv_preemption;     // how a request gives up its rows when a channel is full
+    uint32_t kv_swap_bandwidth_gbps;  // host link of KVPreemption::SWAP
+    bool kv_migration;                // move KV caches from the busiest PIM channel to the idlest
+    double kv_migration_threshold;    // busiest channel MHA latency over the mean that triggers it
+    bool pipeline_parallel;           // n_pp devices, each simulated with its layer slice
+    uint32_t pp_micro_batches;        // the trace is split round robin into this many
+    uint32_t pp_link_bandwidth_gbps;  // device-to-device link
+    uint32_t pp_link_latency;         // unit: core cycle
     uint64_t HBM_size;          // HBM size in bytes
     uint64_t HBM_act_buf_size;  // HBM activation buffer size in bytes
 
@@ -63,6 +100,7 @@ struct SimulationConfig {
     uint32_t systolic_array_count;  // Number of systolic arrays per core
 
     uint32_t n_tp;
+    uint32_t n_pp;  // pipeline stages, one device each
 
     uint32_t vector_core_count;
     uint32_t vector_core_width;
@@ -92,6 +130,7 @@ struct SimulationConfig {
     uint32_t dram_freq;
     uint32_t dram_channels;
     uint32_t dram_req_size;
+    uint32_t dram_tick_threads;  // threads ticking PIM channels in parallel
 
     /* PIM config */
     std::string pim_config_path;
@@ -108,6 +147,12 @@ struct SimulationConfig {
     uint32_t request_interval;
     uint32_t request_total_cnt;
     std::string request_dataset_path;
+    uint32_t request_offset;  // the run takes trace rows request_offset + k * request_stride
+    uint32_t request_stride;
+    ArrivalMode arrival_mode;   // BATCH: whole trace at cycle 0, others are open-loop
+    double arrival_qps;         // mean request rate of POISSON and GAMMA arrivals
+    double arrival_burstiness;  // squared CV of GAMMA inter-arrival times, 1 is Poisson
+    uint32_t arrival_seed;
 
     /* ICNT config */
     IcntType icnt_type;
@@ -125,6 +170,7 @@ struct SimulationConfig {
     uint64_t align_address(uint64_t addr) { return addr - (addr % dram_req_size); }
 };
 
+// thread-local so that a sweep can run several simulations in one process
 namespace Config {
-extern SimulationConfig global_config;
+extern thread_local SimulationConfig global_config;
 }
\ No newline at end of file
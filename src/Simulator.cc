@@ -1,5 +1,8 @@
 #include "Simulator.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <filesystem>
 #include <string>
 
@@ -11,7 +14,8 @@
 
 namespace fs = std::filesystem;
 
-Simulator::Simulator(SimulationConfig config) : _config(config), _core_cycles(0) {
+Simulator::Simulator(SimulationConfig config)
+    : _config(config), _core_cycles(0), _fast_forwarded_cycles(0) {
     // Create dram object
     _core_period = 1.0 / ((double)config.core_freq);
     _icnt_period = 1.0 / ((double)config.icnt_freq);
@@ -27,13 +31,13 @@ Simulator::Simulator(SimulationConfig config) : _config(config), _core_cycles(0)
     _dram = std::make_unique<PIM>(config);
 
     // Create interconnect object
-    _icnt = std::make_unique<SimpleInterconnect>(config);
-    // if (config.icnt_type == IcntType::SIMPLE) {
-    // } else if (config.icnt_type == IcntType::BOOKSIM2) {
-    //     _icnt = std::make_unique<Booksim2Interconnect>(config);
-    // } else {
-    //     assert(0);
-    // }
+    if (config.icnt_type == IcntType::SIMPLE) {
+        _icnt = std::make_unique<SimpleInterconnect>(config);
+    } else if (config.icnt_type == IcntType::BOOKSIM2) {
+        _icnt = std::make_unique<Booksim2Interconnect>(config);
+    } else {
+        assert(0);
+    }
 
     // Create core objects
     _cores.resize(config.num_cores);
@@ -68,15 +72,90 @@ void Simulator::run(std::string model_name) {
 
 void Simulator::update_stage_stat() {
     Stage done_stage = _scheduler->get_prev_stage();
-    _dram->log(done_stage);
+    std::string done_stage_name = _scheduler->get_prev_stage_name();
+    _dram->log(done_stage_name);
 
     _stage_stats.push_back(StageStat{.stage = done_stage,
+                                     .name = done_stage_name,
+                                     .start_cycle =
+                                         _core_cycles - _scheduler->get_prev_stage_cycles(),
                                      .done_cycle = _core_cycles,
                                      .pim_cycles = _dram->get_avg_pim_cycle(),
                                      .npu_cycles = 0,
                                      .mem_bw_util = _dram->get_avg_bw_util()});
 }
 
+// Checkpoint at a stage boundary: every continuation is a fork() of the warmed-up simulator that
+// picks up its own log_dir and sys_config overrides (see check_continuation_config) and runs to
+// the end. The parent waits for them and then finishes the original run.
+void Simulator::fork_continuations() {
+    auto &continuations = _config.checkpoint_continuations;
+    spdlog::info("Checkpoint at stage {}: forking {} continuations", _config.checkpoint_stage,
+                 continuations.size());
+    // tick workers do not survive fork()
+    _dram->set_tick_threads(1);
+    spdlog::default_logger()->flush();
+    fflush(stdout);
+
+    std::vector<std::pair<pid_t, size_t>> children;
+    for (size_t i = 0; i < continuations.size(); i++) {
+        auto &continuation = continuations[i];
+        assert(continuation.contains("log_dir"));
+        if (!check_continuation_config(continuation_config(continuation))) {
+            spdlog::error("Continuation {} skipped: {}", i, (std::string)continuation["log_dir"]);
+            continue;
+        }
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            start_continuation(continuation);
+            return;
+        }
+        children.push_back({pid, i});
+    }
+    for (auto &[pid, i] : children) {
+        int status;
+        waitpid(pid, &status, 0);
+        std::string log_dir = continuations[i]["log_dir"];
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            spdlog::error("Continuation {} failed: {}", i, log_dir);
+        else
+            spdlog::info("Continuation {} done: {}", i, log_dir);
+    }
+    _dram->set_tick_threads(_config.dram_tick_threads);
+    // C/D repeat per layer pair, checkpoint only the first one
+    _config.checkpoint_stage.clear();
+}
+
+// sys_config of a continuation: inline object of overrides or path of a json file holding them
+json Simulator::continuation_config(const json &continuation) {
+    if (!continuation.contains("sys_config")) return json::object();
+    auto &sys_config = continuation["sys_config"];
+    return sys_config.is_string() ? load_config(sys_config) : sys_config;
+}
+
+void Simulator::start_continuation(const json &continuation) {
+    std::string log_dir = continuation["log_dir"];
+    // stage logs written so far belong to this run as well
+    fs::create_directories(log_dir);
+    fs::copy(Config::global_config.log_dir, log_dir,
+             fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+
+    apply_continuation_config(continuation_config(continuation));
+    Config::global_config.log_dir = log_dir;
+    Config::global_config.checkpoint_stage.clear();
+    Config::global_config.checkpoint_continuations = json::array();
+    // components keep their own copy of the config
+    _config = Config::global_config;
+    _scheduler->set_config(_config);
+    _client->set_config(_config);
+
+    _dram->set_log_dir(log_dir);
+    _dram->set_tick_threads(_config.dram_tick_threads);
+    spdlog::info("Continuing from stage {} checkpoint in {}", stageToString(_scheduler->get_stage()),
+                 log_dir);
+}
+
 void Simulator::log_stage_stat() {
     std::string fname = Config::global_config.log_dir + "/_summary.tsv";
     std::ofstream ofile(fname);
@@ -91,15 +170,12 @@ void Simulator::log_stage_stat() {
     header += "mem_bw_util\t";
     ofile << header + "\n";
 
-    int prev_cycle = 0;
-
     for (int i = 0; i < _stage_stats.size(); i++) {
         StageStat stage_stat = _stage_stats[i];
         std::string stage_row = "";
 
-        int total_cycle = stage_stat.done_cycle - prev_cycle;
-        prev_cycle = stage_stat.done_cycle;
-        stage_row += stageToString(stage_stat.stage) + "\t";
+        cycle_type total_cycle = stage_stat.done_cycle - stage_stat.start_cycle;
+        stage_row += stage_stat.name + "\t";
         stage_row += std::to_string(total_cycle) + "\t";
         stage_row += std::to_string(stage_stat.pim_cycles) + "\t";
         stage_row += std::to_string(stage_stat.mem_bw_util) + "\t";
@@ -117,6 +193,7 @@ void Simulator::cycle() {
     while (running()) {
         int model_id = 0;
 
+        if (_config.fast_forward && _core_time <= MIN(_dram_time, _icnt_time)) fast_forward();
         set_cycle_mask();
         // Core Cycle
         if (_cycle_mask & CORE_MASK) {
@@ -135,6 +212,8 @@ void Simulator::cycle() {
                 _scheduler->reset_has_stage_changed_status();
                 // _icnt->log(_scheduler->get_prev_stage());
                 update_stage_stat();
+                if (stageToString(_scheduler->get_stage()) == _config.checkpoint_stage)
+                    fork_continuations();
             }
             _scheduler->cycle();
 
@@ -183,7 +262,7 @@ void Simulator::cycle() {
         if (_cycle_mask & ICNT_MASK) {
             for (int core_id = 0; core_id < _n_cores; core_id++) {
                 for (uint32_t channel_index = 0; channel_index < _n_memories; ++channel_index) {
-                    auto core_ind = core_id * _n_cores + channel_index;
+                    auto core_ind = core_id * _n_memories + channel_index;
                     // core -> ICNT (sub-batch #1)
                     if (_cores[core_id]->has_memory_request1(channel_index)) {
                         MemoryAccess *front = _cores[core_id]->top_memory_request1(channel_index);
@@ -204,8 +283,10 @@ void Simulator::cycle() {
                     }
                     // ICNT -> core
                     if (!_icnt->is_empty(core_ind)) {
-                        _cores[core_id]->push_memory_response(_icnt->top(core_ind));
+                        // pop first, the core recycles the access once it consumes it
+                        MemoryAccess *response = _icnt->top(core_ind);
                         _icnt->pop(core_ind);
+                        _cores[core_id]->push_memory_response(response);
                     }
                 }
             }
@@ -233,10 +314,28 @@ void Simulator::cycle() {
                     }
                 }
 
-                // Pop response to ICNT from dram (log read)
-                if (!_dram->is_empty(dram_ind) && !_icnt->is_full(mem_ind, _dram->top(dram_ind))) {
-                    _icnt->push(mem_ind, get_dest_node(_dram->top(dram_ind)), _dram->top(dram_ind));
-                    _dram->pop(dram_ind);
+                // (KV migration copy -> DRAM)
+                if (_scheduler->has_kv_copy_access(dram_ind)) {
+                    auto copy_req = _scheduler->top_kv_copy_access(dram_ind);
+                    if (!_dram->is_full(dram_ind, copy_req)) {
+                        _dram->push(dram_ind, copy_req);
+                        _scheduler->pop_kv_copy_access(dram_ind);
+                    } else {
+                        _scheduler->stall_kv_copy_access(dram_ind);
+                    }
+                }
+
+                // Pop response to ICNT from dram (log read), copy responses go to the scheduler
+                if (!_dram->is_empty(dram_ind)) {
+                    MemoryAccess *response = _dram->top(dram_ind);
+                    if (_scheduler->is_kv_copy_access(response)) {
+                        _dram->pop(dram_ind);
+                        _scheduler->finish_kv_copy_access(response);
+                    } else if (!_icnt->is_full(mem_ind, response)) {
+                        _scheduler->count_kv_copy_interference(dram_ind);
+                        _icnt->push(mem_ind, get_dest_node(response), response);
+                        _dram->pop(dram_ind);
+                    }
                 }
             }
 
@@ -244,15 +343,18 @@ void Simulator::cycle() {
         }
     }
     spdlog::info("Simulation Finished");
+    if (_config.fast_forward)
+        spdlog::info("Fast-forwarded {} of {} core cycles", _fast_forwarded_cycles, _core_cycles);
     /* Print simulation stats */
     for (int core_id = 0; core_id < _n_cores; core_id++) {
         _cores[core_id]->print_stats();
         _cores[core_id]->log();
     }
-    // _icnt->print_stats();
+    _icnt->print_stats();
     // _icnt->log();
     _dram->print_stat();
     _scheduler->print_stat();
+    _client->print_stat();
     log_stage_stat();
 }
 
@@ -298,6 +400,75 @@ void Simulator::set_cycle_mask() {
     }
 }
 
+// Event-driven fast-forward. When no component can change state before its next timed event
+// (pipeline finish_cycle, interconnect latency), the core and interconnect clocks jump straight
+// to the earliest one and only their stat counters are replayed. DRAM keeps ticking on its own
+// clock since its refresh/bank timing is internal, so skipping only starts once nothing is in
+// flight there. The clock domains are stepped by the same set_cycle_mask() sequence, so every
+// reported cycle count matches the cycle-by-cycle run.
+void Simulator::fast_forward() {
+    const cycle_type never = std::numeric_limits<cycle_type>::max();
+    // the DRAM tick that may return a response is not skipped
+    cycle_type dram_budget = _dram->cycles_to_next_event();
+    if (dram_budget <= 1) return;
+    if (_scheduler->cycles_to_next_event() != never) return;
+    // open-loop clients wake up at the next request arrival
+    cycle_type client_budget = _client->cycles_to_next_event();
+    if (client_budget == 0) return;
+
+    // cores are only ticked while a model program is loaded
+    bool cores_ticked = !_scheduler->empty1() || !_scheduler->empty2();
+    cycle_type core_budget = client_budget;
+    for (int core_id = 0; core_id < _n_cores; core_id++) {
+        cycle_type cycles = _cores[core_id]->cycles_to_next_event();
+        if (cycles == 0) return;
+        if (!cores_ticked) continue;
+        core_budget = MIN(core_budget, cycles);
+
+        // would a tile be issued in this cycle?
+        if (!_scheduler->empty1()) {
+            Tile &tile = _scheduler->top_tile1(core_id);
+            if (tile.status == Tile::Status::INITIALIZED && _cores[core_id]->can_issue(tile))
+                return;
+        }
+        if (!_scheduler->empty2()) {
+            Tile &tile = _scheduler->top_tile2(core_id);
+            if (tile.status == Tile::Status::INITIALIZED && _cores[core_id]->can_issue_pim())
+                return;
+        }
+    }
+    cycle_type icnt_budget = _icnt->cycles_to_next_event();
+    if (core_budget == 0 || icnt_budget == 0) return;
+    // nothing will ever wake us up
+    if (core_budget == never && icnt_budget == never && dram_budget == never) return;
+
+    cycle_type core_skipped = 0;
+    cycle_type icnt_skipped = 0;
+    cycle_type dram_ticks = 0;
+    while (core_skipped < core_budget && icnt_skipped < icnt_budget) {
+        bool dram_next = _dram_time <= MIN3(_core_time, _dram_time, _icnt_time);
+        if (dram_next && dram_ticks + 1 >= dram_budget) break;
+        set_cycle_mask();
+        if (_cycle_mask & CORE_MASK) core_skipped++;
+        if (_cycle_mask & DRAM_MASK) {
+            _dram->cycle();
+            dram_ticks++;
+        }
+        if (_cycle_mask & ICNT_MASK) icnt_skipped++;
+    }
+
+    _client->fast_forward(core_skipped);
+    _scheduler->fast_forward(core_skipped);
+    if (cores_ticked) {
+        for (int core_id = 0; core_id < _n_cores; core_id++) {
+            _cores[core_id]->fast_forward(core_skipped);
+        }
+    }
+    _core_cycles += core_skipped;
+    _icnt->fast_forward(icnt_skipped);
+    _fast_forwarded_cycles += core_skipped;
+}
+
 uint32_t Simulator::get_dest_node(MemoryAccess *access) {
     if (access->request) {
         // MemoryAccess not issued
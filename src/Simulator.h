@@ -26,6 +26,10 @@ class Simulator {
     void cycle();
     bool running();
     void set_cycle_mask();
+    void fast_forward();
+    void fork_continuations();
+    void start_continuation(const json &continuation);
+    json continuation_config(const json &continuation);
     uint32_t get_dest_node(MemoryAccess *access);
     void update_stage_stat();
     void log_stage_stat();
@@ -52,6 +56,7 @@ class Simulator {
     addr_type _dram_ch_stride_size;
 
     uint64_t _core_cycles;
+    uint64_t _fast_forwarded_cycles;
 
     uint32_t _cycle_mask;
     bool _single_run;
@@ -59,9 +64,11 @@ class Simulator {
 
     struct StageStat {
         Stage stage;
-        uint32_t done_cycle;
-        uint32_t pim_cycles;
-        uint32_t npu_cycles;
+        std::string name;
+        cycle_type start_cycle;
+        cycle_type done_cycle;
+        uint64_t pim_cycles;
+        uint64_t npu_cycles;
         double mem_bw_util;
     };
 
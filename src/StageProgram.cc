@@ -15,12 +15,47 @@
 #include "tensor/PIMTensor.h"
 
 StageProgram::StageProgram(Ptr<Model> model, Ptr<BatchedRequest> batched_request,
-                           StagePlatform stage_platform, Stage stage)
+                           StagePlatform stage_platform, Stage stage, uint32_t layer_pair,
+                           uint32_t iteration, uint32_t sub_stage)
     : _model(model),
       _breq(batched_request),
       _stage_platform(stage_platform),
       _stage(stage),
-      _name(stagePlatformToString(stage_platform) + "_stage_" + stageToString(stage)) {
+      _name(stagePlatformToString(stage_platform) + "_stage_" +
+            stageLayerToString(stage, layer_pair, iteration, sub_stage)) {
+    // C/D of layer pair p run Pj/FFNs of layer p and QKVgen of layer p+1
+    uint32_t last_layer = Config::global_config.model_n_layer - 1;
+    if (Config::global_config.layer_sim_mode == LayerSimMode::SINGLE) {
+        _layer = _next_layer = 0;
+    } else if (stage == Stage::C || stage == Stage::D) {
+        _layer = layer_pair;
+        _next_layer = layer_pair + 1;
+    } else if (stage == Stage::E || stage == Stage::F) {
+        _layer = _next_layer = last_layer;
+    } else {
+        _layer = _next_layer = 0;
+    }
+    // MHA#1 of stage D already belongs to the next layer
+    _work = StageWork{.proj_ffns = enable_proj_ffns(),
+                      .qkv_gen = enable_qkv_gen(),
+                      .mha = !skip_pim_stage(),
+                      .layer = _layer,
+                      .next_layer = _next_layer,
+                      .mha_layer = stage == Stage::D ? _next_layer : _layer};
+    this->init_program();
+}
+
+StageProgram::StageProgram(Ptr<Model> model, Ptr<BatchedRequest> batched_request,
+                           StagePlatform stage_platform, Stage stage, StageWork work,
+                           std::string stage_name)
+    : _name(stagePlatformToString(stage_platform) + "_stage_" + stage_name),
+      _model(model),
+      _breq(batched_request),
+      _stage_platform(stage_platform),
+      _stage(stage),
+      _layer(work.layer),
+      _next_layer(work.next_layer),
+      _work(work) {
     this->init_program();
 }
 
@@ -29,6 +64,8 @@ StageProgram::StageProgram(Ptr<Model> model, Ptr<BatchedRequest> batched_request
 // |  SA | QKVgen#1 | QKVgen#2 | Pj/FFNs/QKVgen#1 | Pj/FFNs/QKVgen#2 | Pj/FFNs#1 | Pj/FFNs#2 |
 // | PIM |     -    |  MHA#1   | MHA#2            | MHA#1            |   MHA#2   |     -     |
 //
+// With N sub-batches, B/D/F run for sub-batches #2..#N in turn (the PIM one behind the SA one),
+// which does not change the blocks a stage runs.
 void StageProgram::init_program() {
     assert(_stage != Stage::Finish);
 
@@ -40,7 +77,7 @@ void StageProgram::init_program() {
     }
 
     if (_stage_platform == StagePlatform::PIM) {
-        if (skip_pim_stage()) {
+        if (!_work.mha) {
             std::string yellow = "\033[1;33m";
             std::string reset = "\033[0m";
             spdlog::info("{}PIM: skip{}", yellow, reset);
@@ -66,8 +103,8 @@ void StageProgram::init_SA_program() {
     auto N = _breq->get_num_rows();
     auto E = Config::global_config.model_n_embd;
 
-    bool lets_proj_ffns = enable_proj_ffns();
-    bool lets_qkvgen = enable_qkv_gen();
+    bool lets_proj_ffns = _work.proj_ffns;
+    bool lets_qkvgen = _work.qkv_gen;
 
     std::vector<uint32_t> input_dim{N, E};
     if (lets_proj_ffns) {
@@ -115,6 +152,7 @@ void StageProgram::init_PIM_program() {
     spdlog::info("{}PIM: MHA{}", yellow, reset);
     Ptr<NPUTensor> query;
     std::vector<Ptr<BTensor>> inputs;
+    uint32_t layer = _work.mha_layer;
 
     int sub_batch_size = _breq->_reqs.size();
 
@@ -136,8 +174,8 @@ void StageProgram::init_PIM_program() {
         querys.push_back(query);
 
         /* key/value cache */
-        keys.push_back(request->K_cache[0]);
-        values.push_back(request->V_cache[0]);
+        keys.push_back(request->K_cache[layer]);
+        values.push_back(request->V_cache[layer]);
     }
 
     /* gemv + softmax */
@@ -146,14 +184,14 @@ void StageProgram::init_PIM_program() {
                           keys.end());  // querys, keys
 
     auto logit_softmax = add_op(std::make_shared<NeuPIMSLogitSoftmax>(
-        name_gen(LAYER(0), BlockType::Attention, OperationType::NeuPIMSLogitSoftmax)));
+        name_gen(LAYER(layer), BlockType::Attention, OperationType::NeuPIMSLogitSoftmax)));
     inputs = get_outputs(logit_softmax, mha_pim_inputs);
 
     /* pim_gemv + add */
     inputs.insert(inputs.end(), values.begin(), values.end());  // logits, values
 
     auto attend = add_op(std::make_shared<NeuPIMSAttend>(
-        name_gen(LAYER(0), BlockType::Attention, OperationType::NeuPIMSAttend)));
+        name_gen(LAYER(layer), BlockType::Attention, OperationType::NeuPIMSAttend)));
     inputs = get_outputs(attend, inputs);
 
     find_executable_node(query);
@@ -247,13 +285,15 @@ std::vector<Ptr<BTensor>> StageProgram::projection_block(std::vector<Ptr<BTensor
     auto res_buf =
         std::make_shared<NPUTensor>("residual_buffer", input_dim, NPUTensorBufType::ACT, true);
 
-    int layer = 0;
-    auto prefix = name_gen(LAYER(0), BlockType::Attention);
+    int layer = _layer;
+    auto prefix = name_gen(LAYER(layer), BlockType::Attention);
     // auto res_buf = inputs[0];
 
-    auto projection = add_op(std::make_shared<MatMul>(
+    auto projection_matmul = std::make_shared<MatMul>(
         name_gen(prefix, OperationType::Projection),
-        _model->get_params(layer, BlockType::Attention, OperationType::Projection)));
+        _model->get_params(layer, BlockType::Attention, OperationType::Projection));
+    projection_matmul->set_row_parallel();
+    auto projection = add_op(projection_matmul);
     inputs = get_outputs(projection, inputs);
 
     // fixme: residual is not with this tensor.
@@ -263,7 +303,7 @@ std::vector<Ptr<BTensor>> StageProgram::projection_block(std::vector<Ptr<BTensor
     return inputs;
 }
 std::vector<Ptr<BTensor>> StageProgram::ffn1_block(std::vector<Ptr<BTensor>> inputs) {
-    int layer = 0;
+    int layer = _layer;
     auto res_buf = inputs[0];
     std::string prefix = name_gen(LAYER(layer), BlockType::FeedForward);
     // create operations
@@ -280,9 +320,11 @@ std::vector<Ptr<BTensor>> StageProgram::ffn1_block(std::vector<Ptr<BTensor>> inp
     auto gelu = add_op(std::make_shared<Gelu>(name_gen(prefix, OperationType::Gelu)));
     inputs = get_outputs(gelu, inputs);
 
-    auto fc2 = add_op(std::make_shared<MatMul>(
+    auto fc2_matmul = std::make_shared<MatMul>(
         name_gen(prefix, OperationType::FullyConnected2),
-        _model->get_params(layer, BlockType::FeedForward, OperationType::FullyConnected2)));
+        _model->get_params(layer, BlockType::FeedForward, OperationType::FullyConnected2));
+    fc2_matmul->set_row_parallel();
+    auto fc2 = add_op(fc2_matmul);
     inputs = get_outputs(fc2, inputs);
 
     auto residual = add_op(std::make_shared<Add>(name_gen(prefix, OperationType::Residual)));
@@ -296,8 +338,8 @@ std::vector<Ptr<BTensor>> StageProgram::ffn2_block(std::vector<Ptr<BTensor>> inp
 }
 
 std::vector<Ptr<BTensor>> StageProgram::qkv_gen_block(std::vector<Ptr<BTensor>> inputs) {
-    int layer = 0;
-    auto prefix = name_gen(LAYER(0), BlockType::Attention);
+    int layer = _next_layer;
+    auto prefix = name_gen(LAYER(layer), BlockType::Attention);
 
     // (N,E) -> (N,E)
     auto ln1 = add_op(std::make_shared<LayerNorm>(
@@ -315,7 +357,7 @@ std::vector<Ptr<BTensor>> StageProgram::qkv_gen_block(std::vector<Ptr<BTensor>>
 }
 
 std::vector<Ptr<BTensor>> StageProgram::moe_ffn_block(std::vector<Ptr<BTensor>> inputs) {
-    int layer = 0;
+    int layer = _layer;
     auto res_buf = inputs[0];
     std::string prefix = name_gen(LAYER(layer), BlockType::FeedForward);
     
@@ -358,9 +400,9 @@ std::vector<Ptr<BTensor>> StageProgram::moe_ffn_block(std::vector<Ptr<BTensor>>
         MoERoutingTraceReader trace_reader(trace_path, num_experts, experts_per_token, batch_size);
         if (trace_reader.has_trace()) {
             // Use actual routing from trace file
-            expert_token_counts = trace_reader.get_expert_token_counts(0);  // layer 0
-            expert_token_assignments = trace_reader.get_expert_token_assignments(0);
-            trace_reader.print_distribution(0);
+            expert_token_counts = trace_reader.get_expert_token_counts(layer);
+            expert_token_assignments = trace_reader.get_expert_token_assignments(layer);
+            trace_reader.print_distribution(layer);
         } else {
             // Fall back to simulated distribution
             spdlog::info("Falling back to simulated token distribution");
@@ -551,6 +593,7 @@ std::vector<Ptr<BTensor>> StageProgram::moe_ffn_block(std::vector<Ptr<BTensor>>
             name_gen(expert_prefix, OperationType::FullyConnected2),
             std::vector<Ptr<NPUTensor>>{expert_weights[2], expert_weights[3]});
         expert_fc2_matmul->set_row_count_override(num_tokens);  // KEY: Only process assigned tokens!
+        expert_fc2_matmul->set_row_parallel();
         auto expert_fc2 = add_op(expert_fc2_matmul);
         auto expert_out = get_outputs(expert_fc2, expert_gelu_out);
         
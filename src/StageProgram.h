@@ -13,10 +13,24 @@
 #include "operations/Operation.h"
 #include "tensor/BTensor.h"
 
+// what a platform runs in a stage: from the A-F table, or chosen by the dynamic stage schedule
+struct StageWork {
+    bool proj_ffns = false;  // SA: Pj/FFNs of layer
+    bool qkv_gen = false;    // SA: QKVgen of next_layer
+    bool mha = false;        // PIM: MHA of mha_layer
+    uint32_t layer = 0;
+    uint32_t next_layer = 0;
+    uint32_t mha_layer = 0;
+};
+
 class StageProgram {
    public:
     StageProgram(std::shared_ptr<Model> model, Ptr<BatchedRequest> batched_request,
-                 StagePlatform stage_type, Stage stage);
+                 StagePlatform stage_type, Stage stage, uint32_t layer_pair,
+                 uint32_t iteration, uint32_t sub_stage = 0);
+    // stage: label of the stage for stats
+    StageProgram(std::shared_ptr<Model> model, Ptr<BatchedRequest> batched_request,
+                 StagePlatform stage_type, Stage stage, StageWork work, std::string stage_name);
     void init_program();
     Ptr<Operation> add_op(Ptr<Operation> op);
     std::vector<Ptr<BTensor>> get_outputs(Ptr<Operation> op, std::vector<Ptr<BTensor>> inputs);
@@ -48,6 +62,11 @@ class StageProgram {
     StagePlatform _stage_platform;
     Stage _stage;
 
+    // decoder layer of the Pj/FFNs block and of the QKVgen block
+    uint32_t _layer;
+    uint32_t _next_layer;
+    StageWork _work;
+
     void init_SA_program();
     void init_PIM_program();
 
@@ -70,7 +70,7 @@ void SystolicWS::cycle() {
                 buffer_id = front.spad_id;
             }
 
-            ast(!front.src_addrs.empty());
+            ast(!front.src_ranges.empty());
 
             auto accesses = MemoryAccess::from_instruction(
                 front, generate_mem_access_id(), _config.dram_req_size, MemoryAccessType::READ,
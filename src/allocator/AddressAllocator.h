@@ -57,6 +57,7 @@ class KVCacheAlloc : public Singleton<KVCacheAlloc> {
     uint32_t _num_ele_per_row;  // DRAM row size / precision
     uint32_t _bank_per_ch;
     std::vector<Ptr<std::deque<uint64_t>>> _rows;  // channel -> free rows base index
+    uint64_t _rows_per_ch;                          // KV cache capacity of a channel
 
     void init(addr_type base_addr);
     void init_npu_layout(addr_type base_addr);
@@ -65,4 +66,20 @@ class KVCacheAlloc : public Singleton<KVCacheAlloc> {
     addr_type allocate(uint64_t ch);
     void free(addr_type addr);
     void free(uint32_t ch, uint64_t row);
+    uint64_t num_free_rows(uint32_t ch) { return _rows[ch]->size(); }
+    uint64_t num_used_rows(uint32_t ch) { return _rows_per_ch - _rows[ch]->size(); }
+
+    // prefix sharing: rows of the full blocks of a prompt prefix, referenced by every cache of
+    // that prefix in the channel. key: (ch, prefix hash, tensor)
+    typedef struct {
+        std::vector<uint64_t> rows;
+        uint32_t ref_count;
+    } SharedRows;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, SharedRows> _shared_rows;
+
+    bool has_shared_rows(uint32_t ch, uint32_t prefix_hash, uint32_t tensor);
+    int find_shared_channel(uint32_t prefix_hash);  // -1 if no channel holds the prefix
+    std::vector<uint64_t> acquire_shared_rows(uint32_t ch, uint32_t prefix_hash, uint32_t tensor,
+                                              uint32_t num_rows);
+    void release_shared_rows(uint32_t ch, uint32_t prefix_hash, uint32_t tensor);
 };
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include "AddressAllocator.h"
 
 KVCacheAlloc::KVCacheAlloc()
-    : _kv_cache_size(0), _kv_cache_limit(0), _kv_cache_entry_size(0), _base_addr(0), _base_row(0) {}
+    : _kv_cache_size(0), _kv_cache_limit(0), _kv_cache_entry_size(0), _base_addr(0), _base_row(0),
+      _rows_per_ch(0) {}
 
 void KVCacheAlloc::init(addr_type base_addr) {
     _mode = Config::global_config.run_mode;
@@ -66,12 +67,16 @@ void KVCacheAlloc::init_pim_layout(addr_type base_addr) {
 
     // _rows: channel -> row idx
     uint32_t free_rows_size = row_per_bank - _base_row;
+    if (Config::global_config.kv_rows_per_channel > 0)
+        free_rows_size = std::min(free_rows_size, Config::global_config.kv_rows_per_channel);
+    _rows_per_ch = free_rows_size;
     for (int i = 0; i < _dram_channels; ++i) {
         _rows.push_back(std::make_shared<std::deque<uint64_t>>());
         for (int j = 0; j < free_rows_size; ++j) {
             if (_base_row + j < row_per_bank) _rows[i]->push_back(_base_row + j);
         }
     }
+    spdlog::info("KV cache rows per channel: {}", _rows_per_ch);
 }
 
 // allocate space [bank per ch, d_k], and return
@@ -100,4 +105,41 @@ void KVCacheAlloc::free(addr_type addr) {
 void KVCacheAlloc::free(uint32_t ch, uint64_t row) {
     ast(_mode == RunMode::NPU_PIM);
     _rows[ch]->push_back(row);
+}
+
+bool KVCacheAlloc::has_shared_rows(uint32_t ch, uint32_t prefix_hash, uint32_t tensor) {
+    return _shared_rows.count(std::make_tuple(ch, prefix_hash, tensor)) > 0;
+}
+
+int KVCacheAlloc::find_shared_channel(uint32_t prefix_hash) {
+    for (auto &entry : _shared_rows) {
+        if (std::get<1>(entry.first) == prefix_hash) return std::get<0>(entry.first);
+    }
+    return -1;
+}
+
+// the first cache of a prefix allocates its rows, the others share them
+std::vector<uint64_t> KVCacheAlloc::acquire_shared_rows(uint32_t ch, uint32_t prefix_hash,
+                                                        uint32_t tensor, uint32_t num_rows) {
+    auto key = std::make_tuple(ch, prefix_hash, tensor);
+    auto it = _shared_rows.find(key);
+    if (it != _shared_rows.end()) {
+        ast(it->second.rows.size() == num_rows);
+        it->second.ref_count++;
+        return it->second.rows;
+    }
+
+    SharedRows shared{.ref_count = 1};
+    for (int i = 0; i < num_rows; ++i) shared.rows.push_back(allocate(ch));
+    _shared_rows.emplace(key, shared);
+    return shared.rows;
+}
+
+void KVCacheAlloc::release_shared_rows(uint32_t ch, uint32_t prefix_hash, uint32_t tensor) {
+    auto it = _shared_rows.find(std::make_tuple(ch, prefix_hash, tensor));
+    ast(it != _shared_rows.end());
+    if (--it->second.ref_count > 0) return;
+
+    for (auto row : it->second.rows) free(ch, row);
+    _shared_rows.erase(it);
 }
\ No newline at end of file
@@ -6,15 +6,14 @@ Client::Client(SimulationConfig config)
       _last_request_cycle(0),
       _issued_cnt(0),
       _completed_cnt(0),
-      _need_wait_cycles(0) {  // 30
+      _need_wait_cycles(0),
+      _metrics(config) {  // 30
     // arguments:
     // - request_interval (mean),
     // - total number of requests
     // - request size (input,output)
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    _gen = gen;
+    _gen = std::mt19937(_config.arrival_seed);
 
     // todo: get from config
     _imin = 10;
@@ -23,15 +22,21 @@ Client::Client(SimulationConfig config)
     _omax = 4;
 
     uint32_t answer_index = 1;
-    RequestGenerator::init(config.request_dataset_path, answer_index);
+    RequestGenerator::init(config.request_dataset_path, answer_index, config.request_offset,
+                           config.request_stride);
 
     // _total_cnt = _config.request_total_cnt;
     _total_cnt = RequestGenerator::get_total_req_cnt();
     spdlog::info("Client total request cnt: {}", _total_cnt);
-    _request_interval = _config.request_interval;
 
-    std::poisson_distribution<> d(_request_interval);
-    _distribution = d;
+    // gamma inter-arrival times with shape 1/burstiness keep the mean rate at qps
+    double burstiness = _config.arrival_burstiness;
+    _interval_poisson = std::exponential_distribution<double>(_config.arrival_qps);
+    _interval_gamma =
+        std::gamma_distribution<double>(1 / burstiness, burstiness / _config.arrival_qps);
+    _next_arrival_cycle = 0;
+    if (_config.arrival_mode == ArrivalMode::TRACE && RequestGenerator::has_data())
+        _next_arrival_cycle = next_arrival_cycle();
     _touch = false;
 }
 
@@ -39,10 +44,9 @@ int Client::rand_input_size() { return rand() % (_imax - _imin) + _imin; }
 int Client::rand_output_size() { return rand() % (_omax - _omin) + _omin; }
 
 void Client::cycle() {
-    uint32_t idle_cycles = _cycles - _last_request_cycle;
-    // return; // FIXME: comment
+    cycle_type idle_cycles = _cycles - _last_request_cycle;
     // FIXME: change while to if
-    while (!_touch) {
+    while (!_touch && _cycles >= _next_arrival_cycle) {
         // todo: send request to scheduler
         uint32_t rid = generate_rid();
 
@@ -59,8 +63,11 @@ void Client::cycle() {
             // exit(-1);
         }
         uint32_t input_size = input_output_size.first;
-        uint32_t output_size = 1;  // input_output_size.second;  // 1;
+        // one decode iteration unless the scheduler iterates until the real output length
+        uint32_t output_size = _config.multi_iteration ? RequestGenerator::get_output_len() : 1;
         uint32_t channel = input_output_size.second;
+        auto prefix = RequestGenerator::get_prefix();  // (hash, length)
+        uint32_t prefix_len = std::min(prefix.second, input_size);
         std::shared_ptr<InferRequest> request =
             std::make_shared<InferRequest>(InferRequest{.id = rid,
                                                         .arrival_cycle = _cycles,
@@ -69,7 +76,9 @@ void Client::cycle() {
                                                         .output_size = output_size,
                                                         .is_initiated = false,
                                                         .generated = 0,
-                                                        .channel = channel});
+                                                        .channel = channel,
+                                                        .prefix_hash = prefix.first,
+                                                        .prefix_len = prefix_len});
         _waiting_queue.push(request);
 
         _issued_cnt++;
@@ -78,9 +87,8 @@ void Client::cycle() {
         _last_request_cycle = _cycles;
 
         // set next request interval
-        spdlog::info("xyz");
-        _need_wait_cycles = 0;  // _distribution(_gen);
-        spdlog::info("xyz");
+        if (RequestGenerator::has_data()) _next_arrival_cycle = next_arrival_cycle();
+        _need_wait_cycles = _next_arrival_cycle > _cycles ? _next_arrival_cycle - _cycles : 0;
 
         spdlog::info("Client Request Departure!! now:{} next wait: {}", _cycles, _need_wait_cycles);
         spdlog::info("Request #{}, input size:{}, output size:{}", rid, input_size, output_size);
@@ -94,6 +102,27 @@ void Client::cycle() {
     }
 }
 
+// arrival of the request after the last issued one, BATCH dumps the whole trace at cycle 0
+cycle_type Client::next_arrival_cycle() {
+    double cycles_per_sec = _config.core_freq * 1e6;  // Mhz
+    switch (_config.arrival_mode) {
+        case ArrivalMode::POISSON:
+            return _next_arrival_cycle + std::llround(_interval_poisson(_gen) * cycles_per_sec);
+        case ArrivalMode::GAMMA:
+            return _next_arrival_cycle + std::llround(_interval_gamma(_gen) * cycles_per_sec);
+        case ArrivalMode::TRACE:
+            return (cycle_type)RequestGenerator::peek_arrival_us() * _config.core_freq;
+        default:
+            return 0;
+    }
+}
+
+cycle_type Client::cycles_to_next_event() {
+    if (!_waiting_queue.empty() || _completed_cnt == _total_cnt) return 0;
+    if (!_touch) return _next_arrival_cycle > _cycles ? _next_arrival_cycle - _cycles : 0;
+    return std::numeric_limits<cycle_type>::max();
+}
+
 bool Client::running() {
     return _completed_cnt < _total_cnt;  // FIXME: comment
     return false;
@@ -112,15 +141,15 @@ void Client::receive_response(std::shared_ptr<InferRequest> response) {
 
     response->completed_cycle = _cycles;
     _completed_cnt++;
+    _metrics.record(*response);
+}
 
-    // spdlog::info("Receive response! spend_cycles: {}",
-    //              response->completed_cycle - response->arrival_cycle);
-
-    // todo stat.
-    // delete response;
+void Client::print_stat() {
+    _metrics.print_stat();
+    _metrics.log(_config.log_dir);
 }
 
 uint32_t generate_rid() {
-    static uint32_t rid{0};
+    static thread_local uint32_t rid{0};
     return rid++;
 }
@@ -6,34 +6,45 @@
 
 #include "../Common.h"
 #include "../RequestGenerator.h"
+#include "RequestMetrics.h"
 
 uint32_t generate_rid();
 class Client {
    public:
     Client(SimulationConfig config);
     void cycle();
+    cycle_type cycles_to_next_event();
+    void fast_forward(cycle_type cycles) { _cycles += cycles; }
 
     bool running();
     bool has_request();
     std::shared_ptr<InferRequest> pop_request();
     void receive_response(std::shared_ptr<InferRequest> response);
+    void print_stat();
+    void set_config(SimulationConfig config) {
+        _config = config;
+        _metrics.set_config(config);
+    }
 
    private:
     SimulationConfig _config;
-    uint32_t _cycles;
-    uint32_t _last_request_cycle;
-    uint32_t _need_wait_cycles;
+    cycle_type _cycles;
+    cycle_type _last_request_cycle;
+    cycle_type _need_wait_cycles;
 
     uint32_t _total_cnt;
     uint32_t _issued_cnt;
     uint32_t _completed_cnt;
 
-    uint32_t _request_interval;  // send a request per (core_freq/qps) cycles
     std::queue<std::shared_ptr<InferRequest>> _waiting_queue;
+    RequestMetrics _metrics;
 
-    /* Random generate from poisson disribution (request arrival time)*/
+    /* Open-loop request arrival time (see ArrivalMode) */
+    cycle_type _next_arrival_cycle;
     std::mt19937 _gen;
-    std::poisson_distribution<> _distribution;
+    std::exponential_distribution<double> _interval_poisson;  // unit: sec
+    std::gamma_distribution<double> _interval_gamma;          // unit: sec
+    cycle_type next_arrival_cycle();
 
     /* Random generate from uniform d (input, output size) [min, max)*/
     int _imin;
@@ -0,0 +1,130 @@
+#include "RequestMetrics.h"
+
+RequestMetrics::RequestMetrics(SimulationConfig config) : _config(config) {}
+
+void RequestMetrics::record(const InferRequest &request) {
+    ast(!request.token_cycles.empty());
+    cycle_type first_token_cycle = request.token_cycles.front();
+    cycle_type last_token_cycle = request.token_cycles.back();
+    uint32_t n_tokens = request.token_cycles.size();
+
+    RequestStat stat{.id = request.id,
+                     // generated tokens but the last one were appended to the input
+                     .input_size = request.input_size - (n_tokens - 1),
+                     .output_size = request.output_size,
+                     .arrival_cycle = request.arrival_cycle,
+                     .first_token_cycle = first_token_cycle,
+                     .completed_cycle = request.completed_cycle,
+                     .ttft = first_token_cycle - request.arrival_cycle,
+                     .tpot = n_tokens > 1
+                                 ? (double)(last_token_cycle - first_token_cycle) / (n_tokens - 1)
+                                 : 0,
+                     .e2e = request.completed_cycle - request.arrival_cycle};
+    stat.slo_met = meets_slo(stat);
+    _request_stats.push_back(stat);
+}
+
+// checkpoint continuations may change the SLO, requests done before the fork are judged again
+void RequestMetrics::set_config(SimulationConfig config) {
+    _config = config;
+    for (auto &stat : _request_stats) stat.slo_met = meets_slo(stat);
+}
+
+bool RequestMetrics::meets_slo(const RequestStat &stat) {
+    return (_config.slo_ttft_cycles == 0 || stat.ttft <= _config.slo_ttft_cycles) &&
+           (_config.slo_tpot_cycles == 0 || stat.tpot <= _config.slo_tpot_cycles);
+}
+
+// nearest-rank percentiles
+RequestMetrics::Distribution RequestMetrics::distribution(std::vector<double> values) {
+    if (values.empty()) return Distribution{0, 0, 0, 0, 0};
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+        size_t rank = std::ceil(p / 100 * values.size());
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+    double sum = 0;
+    for (auto value : values) sum += value;
+    return Distribution{.mean = sum / values.size(),
+                        .p50 = percentile(50),
+                        .p90 = percentile(90),
+                        .p99 = percentile(99),
+                        .max = values.back()};
+}
+
+json RequestMetrics::summary() {
+    std::vector<double> ttfts, tpots, e2es;
+    cycle_type first_arrival = std::numeric_limits<cycle_type>::max();
+    cycle_type last_completion = 0;
+    uint64_t tokens = 0;
+    uint32_t slo_met = 0;
+    for (auto &stat : _request_stats) {
+        ttfts.push_back(stat.ttft);
+        if (stat.output_size > 1) tpots.push_back(stat.tpot);
+        e2es.push_back(stat.e2e);
+        first_arrival = std::min(first_arrival, stat.arrival_cycle);
+        last_completion = std::max(last_completion, stat.completed_cycle);
+        tokens += stat.output_size;
+        slo_met += stat.slo_met;
+    }
+    cycle_type duration = _request_stats.empty() ? 0 : last_completion - first_arrival;
+    double seconds = (double)duration / (_config.core_freq * 1e6);  // Mhz
+
+    auto to_json = [](Distribution dist) {
+        return json{{"mean", dist.mean}, {"p50", dist.p50}, {"p90", dist.p90},
+                    {"p99", dist.p99},   {"max", dist.max}};
+    };
+    return json{
+        {"requests", _request_stats.size()},
+        {"generated_tokens", tokens},
+        {"duration_cycles", duration},
+        {"throughput_reqs_per_sec", seconds > 0 ? _request_stats.size() / seconds : 0},
+        {"throughput_tokens_per_sec", seconds > 0 ? tokens / seconds : 0},
+        {"slo_ttft_cycles", _config.slo_ttft_cycles},
+        {"slo_tpot_cycles", _config.slo_tpot_cycles},
+        {"slo_attainment",
+         _request_stats.empty() ? 0 : (double)slo_met / _request_stats.size()},
+        {"goodput_reqs_per_sec", seconds > 0 ? slo_met / seconds : 0},
+        {"ttft_cycles", to_json(distribution(ttfts))},
+        {"tpot_cycles", to_json(distribution(tpots))},
+        {"e2e_cycles", to_json(distribution(e2es))},
+    };
+}
+
+void RequestMetrics::print_stat() {
+    json stat = summary();
+    spdlog::info("Requests: {}, throughput: {:.2f} req/s, goodput: {:.2f} req/s (SLO {:.1f}%)",
+                 stat["requests"].get<size_t>(), stat["throughput_reqs_per_sec"].get<double>(),
+                 stat["goodput_reqs_per_sec"].get<double>(),
+                 stat["slo_attainment"].get<double>() * 100);
+    for (std::string metric : {"ttft_cycles", "tpot_cycles", "e2e_cycles"}) {
+        spdlog::info("{} p50: {:.1f}, p99: {:.1f}, max: {:.1f}", metric,
+                     stat[metric]["p50"].get<double>(), stat[metric]["p99"].get<double>(),
+                     stat[metric]["max"].get<double>());
+    }
+}
+
+void RequestMetrics::log(std::string log_dir) {
+    std::string fname = log_dir + "/_requests.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "id\tinput_size\toutput_size\tarrival_cycle\tfirst_token_cycle\tcompleted_cycle\t"
+             "ttft\ttpot\te2e\tslo_met\n";
+    for (auto &stat : _request_stats) {
+        ofile << stat.id << "\t" << stat.input_size << "\t" << stat.output_size << "\t"
+              << stat.arrival_cycle << "\t" << stat.first_token_cycle << "\t"
+              << stat.completed_cycle << "\t" << stat.ttft << "\t" << stat.tpot << "\t"
+              << stat.e2e << "\t" << stat.slo_met << "\n";
+    }
+    ofile.close();
+
+    fname = log_dir + "/_request_metrics.json";
+    ofile.open(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << summary().dump(4) << "\n";
+    ofile.close();
+}
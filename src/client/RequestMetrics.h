@@ -0,0 +1,49 @@
+#pragma once
+#include "../Common.h"
+
+/**
+ * Request-level latency metrics collected by the client
+ *
+ * TTFT: first token cycle - arrival cycle
+ * TPOT: (last token cycle - first token cycle) / (# tokens - 1), only for requests with 2+ tokens
+ * E2E:  completed cycle - arrival cycle
+ * A request meets the SLO if its TTFT and TPOT are within slo_ttft_cycles / slo_tpot_cycles
+ * (0 disables a bound), goodput is the rate of requests meeting it.
+ */
+class RequestMetrics {
+   public:
+    RequestMetrics(SimulationConfig config);
+    void record(const InferRequest &request);
+    void print_stat();
+    void log(std::string log_dir);
+    void set_config(SimulationConfig config);
+
+   private:
+    typedef struct {
+        uint32_t id = 0;
+        uint32_t input_size = 0;
+        uint32_t output_size = 0;
+        cycle_type arrival_cycle = 0;
+        cycle_type first_token_cycle = 0;
+        cycle_type completed_cycle = 0;
+        cycle_type ttft = 0;
+        double tpot = 0;
+        cycle_type e2e = 0;
+        bool slo_met = false;
+    } RequestStat;
+
+    typedef struct {
+        double mean;
+        double p50;
+        double p90;
+        double p99;
+        double max;
+    } Distribution;
+
+    SimulationConfig _config;
+    std::vector<RequestStat> _request_stats;
+
+    bool meets_slo(const RequestStat &stat);
+    Distribution distribution(std::vector<double> values);
+    json summary();
+};
@@ -1,73 +1,64 @@
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "Pipeline.h"
+#include "RequestGenerator.h"
 #include "Simulator.h"
 #include "allocator/AddressAllocator.h"
 #include "helper/CommandLineParser.h"
+#include "operations/GemmModel.h"
 #include "operations/Operation.h"
 
 namespace po = boost::program_options;
 
-int main(int argc, char **argv) {
-    // parse command line argumnet
-    CommandLineParser cmd_parser = CommandLineParser();
-    cmd_parser.add_command_line_option<std::string>("config",
-                                                    "Path for hardware configuration file");
-    cmd_parser.add_command_line_option<std::string>("mem_config",
-                                                    "Path for memory configuration file");
-    cmd_parser.add_command_line_option<std::string>("cli_config",
-                                                    "Path for client configuration file");
-    cmd_parser.add_command_line_option<std::string>("model_config",
-                                                    "Path for model configuration file");
-    cmd_parser.add_command_line_option<std::string>("sys_config",
-                                                    "Path for system configuration file");
-    cmd_parser.add_command_line_option<std::string>("log_dir",
-                                                    "Path for experiment result log directory");
-
-    cmd_parser.add_command_line_option<std::string>("models_list", "Path for the models list file");
-    cmd_parser.add_command_line_option<std::string>(
-        "log_level", "Set for log level [trace, debug, info], default = info");
-    cmd_parser.add_command_line_option<std::string>("mode", "choose one_model or two_model");
-
-    try {
-        cmd_parser.parse(argc, argv);
-    } catch (const CommandLineParser::ParsingError &e) {
-        spdlog::error("Command line argument parrsing error captured. Error message: {}", e.what());
-        throw(e);
-    }
-    std::string model_base_path = "./models";
-    std::string level = "info";
-    cmd_parser.set_if_defined("log_level", &level);
-    if (level == "trace")
-        spdlog::set_level(spdlog::level::trace);
-    else if (level == "debug")
-        spdlog::set_level(spdlog::level::debug);
-    else if (level == "info")
-        spdlog::set_level(spdlog::level::info);
-
+typedef struct {
     std::string config_path;
-    cmd_parser.set_if_defined("config", &config_path);
+    std::string mem_config_path;
+    std::string cli_config_path;
+    std::string model_config_path;
+    std::string sys_config_path;
+    std::string log_dir_path;
+    double arrival_qps = 0;  // overrides the sys_config request rate if > 0
+    uint32_t num_cores = 0;  // overrides the config core count if > 0
+    // pipeline stage runs: layer slice and micro-batch (trace rows offset + k * stride)
+    uint32_t model_n_layer = 0;
+    uint32_t request_offset = 0;
+    uint32_t request_stride = 1;
+} SimulationPaths;
 
+void initialize_configs(const SimulationPaths &paths) {
     json config_json;
-    std::ifstream config_file(config_path);
+    std::ifstream config_file(paths.config_path);
     config_file >> config_json;
     config_file.close();
     Config::global_config = initialize_config(config_json);
 
-    std::string mem_config_path;
-    cmd_parser.set_if_defined("mem_config", &mem_config_path);
-    std::string cli_config_path;
-    cmd_parser.set_if_defined("cli_config", &cli_config_path);
-    std::string model_config_path;
-    cmd_parser.set_if_defined("model_config", &model_config_path);
-    std::string sys_config_path;
-    cmd_parser.set_if_defined("sys_config", &sys_config_path);
-    std::string log_dir_path;
-    cmd_parser.set_if_defined("log_dir", &log_dir_path);
+    initialize_memory_config(paths.mem_config_path);
+    initialize_client_config(paths.cli_config_path);
+    initialize_model_config(paths.model_config_path);
+    initialize_system_config(paths.sys_config_path);
+    if (paths.arrival_qps > 0) {
+        Config::global_config.arrival_qps = paths.arrival_qps;
+        ArrivalMode mode = Config::global_config.arrival_mode;
+        if (mode != ArrivalMode::POISSON && mode != ArrivalMode::GAMMA)
+            Config::global_config.arrival_mode = ArrivalMode::POISSON;
+    }
+    if (paths.num_cores > 0) Config::global_config.num_cores = paths.num_cores;
+    if (paths.model_n_layer > 0) Config::global_config.model_n_layer = paths.model_n_layer;
+    Config::global_config.request_offset = paths.request_offset;
+    Config::global_config.request_stride = paths.request_stride;
 
-    initialize_memory_config(mem_config_path);
-    initialize_client_config(cli_config_path);
-    initialize_model_config(model_config_path);
-    initialize_system_config(sys_config_path);
+    Config::global_config.log_dir = paths.log_dir_path;
+}
 
-    Config::global_config.log_dir = log_dir_path;
+// Config, allocators and id counters are thread-local, so every call needs a thread of its own
+// that has not run a simulation before.
+void run_simulation(const SimulationPaths &paths, bool in_sweep = false) {
+    initialize_configs(paths);
+    // fork() copies every sweep thread into each continuation
+    if (in_sweep && !Config::global_config.checkpoint_stage.empty())
+        throw std::runtime_error("checkpoint_stage is not supported in sweep mode");
 
     Operation::initialize(Config::global_config);
 
@@ -98,6 +89,13 @@ int main(int argc, char **argv) {
     simulator->run(model_name);
 
     MemoryAccess::log_count();
+    spdlog::info("Tile cache: {} hits, {} misses", TileCache::GetInstance()->_hits,
+                 TileCache::GetInstance()->_misses);
+    if (Config::global_config.analytical_gemm) {
+        spdlog::info("GEMM model: {} analytical, {} cycle-accurate",
+                     GemmModel::GetInstance()->_analytical_ops,
+                     GemmModel::GetInstance()->_sampled_ops);
+    }
 
     std::string yellow = "\033[1;33m";
     std::string red = "\033[1;31m";
@@ -106,5 +104,287 @@ int main(int argc, char **argv) {
     spdlog::info("{}mode: {} {}{}", color, prefix,
                  Config::global_config.run_mode == RunMode::NPU_ONLY ? "NPU-only" : "NPU+PIM",
                  "\033[0m");
+
+    simulator.reset();
+    model.reset();
+    WgtAlloc::Delete();
+    ActAlloc::Delete();
+    KVCacheAlloc::Delete();
+    TileCache::Delete();
+    GemmModel::Delete();
+}
+
+// Runs every simulation on its own thread, num_threads at a time. Returns the number of failed runs.
+uint32_t run_parallel(const std::vector<SimulationPaths> &runs, uint32_t num_threads) {
+    num_threads = std::max(1u, std::min<uint32_t>(num_threads, runs.size()));
+    spdlog::info("Sweep: {} runs on {} threads", runs.size(), num_threads);
+
+    std::atomic<size_t> next_run{0};
+    std::atomic<uint32_t> failed_runs{0};
+    auto worker = [&]() {
+        for (size_t i = next_run++; i < runs.size(); i = next_run++) {
+            // a fresh thread per run starts from pristine thread-local simulator state
+            std::thread([&, i]() {
+                try {
+                    run_simulation(runs[i], true);
+                    spdlog::info("Sweep run {} done: {}", i, runs[i].log_dir_path);
+                } catch (const std::exception &e) {
+                    failed_runs++;
+                    spdlog::error("Sweep run {} failed ({}): {}", i, runs[i].log_dir_path,
+                                  e.what());
+                }
+            }).join();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < num_threads; t++) workers.emplace_back(worker);
+    for (auto &t : workers) t.join();
+
+    spdlog::info("Sweep finished: {} of {} runs succeeded", runs.size() - failed_runs,
+                 runs.size());
+    return failed_runs;
+}
+
+// Sweep file: json list of runs, keys are the command line path options
+// (config, mem_config, cli_config, model_config, sys_config, log_dir), arrival_qps and num_cores.
+// Missing keys fall back to the command line value, log_dir is required.
+void run_sweep(std::string sweep_path, const SimulationPaths &defaults, uint32_t num_threads) {
+    json sweep = load_config(sweep_path);
+    assert(sweep.is_array());
+
+    std::vector<SimulationPaths> runs;
+    for (auto &run : sweep) {
+        assert(run.contains("log_dir"));
+        runs.push_back(SimulationPaths{
+            .config_path = run.value("config", defaults.config_path),
+            .mem_config_path = run.value("mem_config", defaults.mem_config_path),
+            .cli_config_path = run.value("cli_config", defaults.cli_config_path),
+            .model_config_path = run.value("model_config", defaults.model_config_path),
+            .sys_config_path = run.value("sys_config", defaults.sys_config_path),
+            .log_dir_path = run["log_dir"],
+            .arrival_qps = run.value("arrival_qps", defaults.arrival_qps),
+            .num_cores = run.value("num_cores", defaults.num_cores),
+        });
+        std::filesystem::create_directories(runs.back().log_dir_path);
+    }
+    run_parallel(runs, num_threads);
+}
+
+// Latency-vs-load sweep: one open-loop run per request rate in log_dir/qps_<qps>, summarized in
+// log_dir/_qps_sweep.tsv. Throughput stops following the offered load once the system saturates,
+// the saturation point is the lowest rate reaching 95% of the highest throughput.
+void run_qps_sweep(std::string qps_list, const SimulationPaths &defaults, uint32_t num_threads) {
+    std::vector<SimulationPaths> runs;
+    std::istringstream iss(qps_list);
+    std::string qps;
+    while (std::getline(iss, qps, ',')) {
+        SimulationPaths run = defaults;
+        run.arrival_qps = std::stod(qps);
+        run.log_dir_path = defaults.log_dir_path + "/qps_" + qps;
+        std::filesystem::create_directories(run.log_dir_path);
+        runs.push_back(run);
+    }
+    assert(!runs.empty());
+    // in increasing load, the first run reaching 95% is then the lowest rate
+    std::sort(runs.begin(), runs.end(), [](const SimulationPaths &a, const SimulationPaths &b) {
+        return a.arrival_qps < b.arrival_qps;
+    });
+    if (run_parallel(runs, num_threads) > 0) return;
+
+    std::vector<json> metrics;
+    double max_throughput = 0;
+    for (auto &run : runs) {
+        metrics.push_back(load_config(run.log_dir_path + "/_request_metrics.json"));
+        double throughput = metrics.back()["throughput_reqs_per_sec"];
+        max_throughput = std::max(max_throughput, throughput);
+    }
+
+    std::ofstream ofile(defaults.log_dir_path + "/_qps_sweep.tsv");
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "qps\tthroughput\tgoodput\tttft_p50\tttft_p99\ttpot_p50\ttpot_p99\te2e_p50\t"
+             "e2e_p99\n";
+    double saturation_qps = 0;
+    for (size_t i = 0; i < runs.size(); i++) {
+        json &m = metrics[i];
+        double throughput = m["throughput_reqs_per_sec"];
+        if (saturation_qps == 0 && throughput >= 0.95 * max_throughput)
+            saturation_qps = runs[i].arrival_qps;
+        ofile << runs[i].arrival_qps << "\t" << throughput << "\t" << m["goodput_reqs_per_sec"]
+              << "\t" << m["ttft_cycles"]["p50"] << "\t" << m["ttft_cycles"]["p99"] << "\t"
+              << m["tpot_cycles"]["p50"] << "\t" << m["tpot_cycles"]["p99"] << "\t"
+              << m["e2e_cycles"]["p50"] << "\t" << m["e2e_cycles"]["p99"] << "\n";
+    }
+    ofile.close();
+    spdlog::info("QPS sweep: max throughput {:.2f} req/s, saturated at {} qps", max_throughput,
+                 saturation_qps);
+}
+
+// Scale-out sweep: one run per NPU core count in log_dir/cores_<n>, summarized in
+// log_dir/_cores_sweep.tsv. Scaling efficiency is the speedup over the first core count divided
+// by the growth in cores, 1 for linear scaling.
+void run_cores_sweep(std::string cores_list, const SimulationPaths &defaults,
+                     uint32_t num_threads) {
+    std::vector<SimulationPaths> runs;
+    std::istringstream iss(cores_list);
+    std::string cores;
+    while (std::getline(iss, cores, ',')) {
+        SimulationPaths run = defaults;
+        run.num_cores = std::stoul(cores);
+        assert(run.num_cores > 0);
+        run.log_dir_path = defaults.log_dir_path + "/cores_" + cores;
+        std::filesystem::create_directories(run.log_dir_path);
+        runs.push_back(run);
+    }
+    assert(!runs.empty());
+    if (run_parallel(runs, num_threads) > 0) return;
+
+    std::ofstream ofile(defaults.log_dir_path + "/_cores_sweep.tsv");
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "cores\tthroughput\tspeedup\tscaling_efficiency\te2e_p50\te2e_p99\n";
+    double base_throughput = 0;
+    for (auto &run : runs) {
+        json m = load_config(run.log_dir_path + "/_request_metrics.json");
+        double throughput = m["throughput_reqs_per_sec"];
+        if (base_throughput == 0) base_throughput = throughput;
+        double speedup = base_throughput > 0 ? throughput / base_throughput : 0;
+        double efficiency = speedup * runs[0].num_cores / run.num_cores;
+        ofile << run.num_cores << "\t" << throughput << "\t" << speedup << "\t" << efficiency
+              << "\t" << m["e2e_cycles"]["p50"] << "\t" << m["e2e_cycles"]["p99"] << "\n";
+        spdlog::info("Cores sweep: {} cores, {:.2f} req/s, scaling efficiency {:.2f}",
+                     run.num_cores, throughput, efficiency);
+    }
+    ofile.close();
+}
+
+// Pipeline-parallel deployment: one run per distinct layer slice and micro-batch in
+// log_dir/mb<micro-batch>_layers<layers>, then the micro-batches are pipelined through the
+// n_pp devices (Pipeline) into log_dir/_pipeline.tsv.
+void run_pipeline(const SimulationPaths &defaults, uint32_t num_threads) {
+    initialize_configs(defaults);
+    RequestGenerator::init(Config::global_config.request_dataset_path, 1);
+    uint32_t micro_batches = std::min<uint32_t>(Config::global_config.pp_micro_batches,
+                                                RequestGenerator::get_total_req_cnt());
+    Config::global_config.pp_micro_batches = micro_batches;
+    Pipeline pipeline(Config::global_config);
+    auto device_layers = pipeline.device_layers();
+    std::set<uint32_t> slices(device_layers.begin(), device_layers.end());
+    spdlog::info("Pipeline: layers per device {}, {} micro-batches", device_layers, micro_batches);
+
+    std::vector<SimulationPaths> runs;
+    for (uint32_t micro_batch = 0; micro_batch < micro_batches; micro_batch++) {
+        for (uint32_t layers : slices) {
+            SimulationPaths run = defaults;
+            run.model_n_layer = layers;
+            run.request_offset = micro_batch;
+            run.request_stride = micro_batches;
+            run.log_dir_path = fmt::format("{}/mb{}_layers{}", defaults.log_dir_path,
+                                           micro_batch, layers);
+            std::filesystem::create_directories(run.log_dir_path);
+            runs.push_back(run);
+        }
+    }
+    if (run_parallel(runs, num_threads) > 0) return;
+
+    for (auto &run : runs) {
+        // estimated_cycles of _layer_estimate.tsv, simulated_cycles if there is no estimate
+        std::ifstream estimate_file(run.log_dir_path + "/_layer_estimate.tsv");
+        std::string header, n_layer, pairs, simulated, estimated;
+        std::getline(estimate_file, header);
+        estimate_file >> n_layer >> pairs >> simulated >> estimated;
+        double cycles = std::stod(estimated == "-" ? simulated : estimated);
+
+        std::ifstream iteration_file(run.log_dir_path + "/_iterations.tsv");
+        uint32_t iterations = 0;
+        for (std::string line; std::getline(iteration_file, line);) iterations++;
+        json metrics = load_config(run.log_dir_path + "/_request_metrics.json");
+        pipeline.add_stage_run(run.model_n_layer, run.request_offset, cycles,
+                               iterations > 0 ? iterations - 1 : 1, metrics["requests"]);
+    }
+    pipeline.schedule(defaults.log_dir_path);
+}
+
+int main(int argc, char **argv) {
+    // parse command line argumnet
+    CommandLineParser cmd_parser = CommandLineParser();
+    cmd_parser.add_command_line_option<std::string>("config",
+                                                    "Path for hardware configuration file");
+    cmd_parser.add_command_line_option<std::string>("mem_config",
+                                                    "Path for memory configuration file");
+    cmd_parser.add_command_line_option<std::string>("cli_config",
+                                                    "Path for client configuration file");
+    cmd_parser.add_command_line_option<std::string>("model_config",
+                                                    "Path for model configuration file");
+    cmd_parser.add_command_line_option<std::string>("sys_config",
+                                                    "Path for system configuration file");
+    cmd_parser.add_command_line_option<std::string>("log_dir",
+                                                    "Path for experiment result log directory");
+
+    cmd_parser.add_command_line_option<std::string>("models_list", "Path for the models list file");
+    cmd_parser.add_command_line_option<std::string>(
+        "log_level", "Set for log level [trace, debug, info], default = info");
+    cmd_parser.add_command_line_option<std::string>("mode", "choose one_model or two_model");
+    cmd_parser.add_command_line_option<std::string>(
+        "sweep", "Path for sweep file, runs every listed configuration in this process");
+    cmd_parser.add_command_line_option<uint32_t>(
+        "sweep_threads", "Number of sweep runs simulated in parallel, default = #cpus");
+    cmd_parser.add_command_line_option<std::string>(
+        "qps_sweep", "Comma separated request rates, runs one open-loop simulation per rate");
+    cmd_parser.add_command_line_option<std::string>(
+        "cores_sweep", "Comma separated NPU core counts, runs one simulation per count");
+
+    try {
+        cmd_parser.parse(argc, argv);
+    } catch (const CommandLineParser::ParsingError &e) {
+        spdlog::error("Command line argument parrsing error captured. Error message: {}", e.what());
+        throw(e);
+    }
+    std::string model_base_path = "./models";
+    std::string level = "info";
+    cmd_parser.set_if_defined("log_level", &level);
+    if (level == "trace")
+        spdlog::set_level(spdlog::level::trace);
+    else if (level == "debug")
+        spdlog::set_level(spdlog::level::debug);
+    else if (level == "info")
+        spdlog::set_level(spdlog::level::info);
+
+    SimulationPaths paths;
+    cmd_parser.set_if_defined("config", &paths.config_path);
+    cmd_parser.set_if_defined("mem_config", &paths.mem_config_path);
+    cmd_parser.set_if_defined("cli_config", &paths.cli_config_path);
+    cmd_parser.set_if_defined("model_config", &paths.model_config_path);
+    cmd_parser.set_if_defined("sys_config", &paths.sys_config_path);
+    cmd_parser.set_if_defined("log_dir", &paths.log_dir_path);
+
+    std::string sweep_path;
+    std::string qps_list;
+    std::string cores_list;
+    uint32_t sweep_threads = std::thread::hardware_concurrency();
+    cmd_parser.set_if_defined("sweep", &sweep_path);
+    cmd_parser.set_if_defined("qps_sweep", &qps_list);
+    cmd_parser.set_if_defined("cores_sweep", &cores_list);
+    cmd_parser.set_if_defined("sweep_threads", &sweep_threads);
+    if (!sweep_path.empty()) {
+        run_sweep(sweep_path, paths, sweep_threads);
+        return 0;
+    }
+    if (!qps_list.empty()) {
+        run_qps_sweep(qps_list, paths, sweep_threads);
+        return 0;
+    }
+    if (!cores_list.empty()) {
+        run_cores_sweep(cores_list, paths, sweep_threads);
+        return 0;
+    }
+    if (load_config(paths.sys_config_path).value("pipeline_parallel", false)) {
+        run_pipeline(paths, sweep_threads);
+        return 0;
+    }
+
+    run_simulation(paths);
     return 0;
 }
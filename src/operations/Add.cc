@@ -87,7 +87,7 @@ Tile Add::initialize_instructions(uint32_t N) {
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_activation0_offset,
             .size = (uint32_t)activation_addrs.size() * _config.precision,
-            .src_addrs = std::move(activation_addrs),
+            .src_ranges = std::move(activation_addrs),
             .operand_id = _INPUT_OPERAND,
         });
 
@@ -96,7 +96,7 @@ Tile Add::initialize_instructions(uint32_t N) {
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_activation1_offset,
             .size = (uint32_t)activation_addrs.size() * _config.precision,
-            .src_addrs = std::move(activation_addrs),
+            .src_ranges = std::move(activation_addrs),
             .operand_id = _INPUT_OPERAND,
         });
 
@@ -113,7 +113,7 @@ Tile Add::initialize_instructions(uint32_t N) {
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_accumulation_offset,
             .size = (uint32_t)output_addrs.size() * _config.precision,
-            .src_addrs = std::move(output_addrs),
+            .src_ranges = std::move(output_addrs),
             .operand_id = _OUTPUT_OPERAND,
         });
     }
@@ -116,9 +116,9 @@ void FusedMHA::initialize_instructions(Tile &tile, int req_idx, int head_idx, in
         addr_type sram_l_ofs = sram_logit_base + h_ofs * (q_len * seq_len) * _config.precision;
         addr_type sram_acc_ofs = sram_accumulation_base + h_ofs * (q_len * _dk) * _config.precision;
 
-        std::vector<addr_type> dram_query_addrs;  // = _query[req_idx]->get_all_addrs();
-        std::vector<addr_type> dram_key_addrs;    // = _key[req_idx]->get_all_addrs();
-        std::vector<addr_type> dram_value_addrs;
+        AddrRanges dram_query_addrs;  // = _query[req_idx]->get_all_addrs();
+        AddrRanges dram_key_addrs;    // = _key[req_idx]->get_all_addrs();
+        AddrRanges dram_value_addrs;
 
         for (int i = 0; i < _dk; i++) {
             for (int seq_idx = 0; seq_idx < seq_len; seq_idx++) {
@@ -153,21 +153,21 @@ void FusedMHA::initialize_instructions(Tile &tile, int req_idx, int head_idx, in
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_q_ofs,
             .size = (q_len * _dk) * _config.precision,
-            .src_addrs = std::move(dram_query_addrs),
+            .src_ranges = std::move(dram_query_addrs),
             .operand_id = _INPUT_OPERAND,  // query
         });
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_k_ofs,
             .size = (seq_len * _dk) * _config.precision,
-            .src_addrs = std::move(dram_key_addrs),
+            .src_ranges = std::move(dram_key_addrs),
             .operand_id = _INPUT_OPERAND + 1,  // key
         });
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_v_ofs,
             .size = (seq_len * _dk) * _config.precision,
-            .src_addrs = std::move(dram_value_addrs),
+            .src_ranges = std::move(dram_value_addrs),
             .operand_id = _INPUT_OPERAND + 2,  // value
         });
 
@@ -213,7 +213,7 @@ void FusedMHA::initialize_instructions(Tile &tile, int req_idx, int head_idx, in
             .opcode = Opcode::MOVOUT,
             .dest_addr = output_ofs,
             .size = q_len * _dk * _config.precision,
-            .src_addrs = std::move(std::static_pointer_cast<NPUTensor>(_outputs[req_idx])
+            .src_ranges = std::move(std::static_pointer_cast<NPUTensor>(_outputs[req_idx])
                                        ->_inners[h_idx]
                                        ->get_all_addrs()),
             .operand_id = _OUTPUT_OPERAND,
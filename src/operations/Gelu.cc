@@ -16,16 +16,14 @@ std::vector<Ptr<BTensor>> Gelu::get_outputs(std::vector<Ptr<BTensor>> inputs) {
         std::make_shared<NPUTensor>(_name + "_output", _input_dim, NPUTensorBufType::ACT, false);
 
     calculate_loops();
-    initialize_tiles();
+    lookup_tile_cache("Gelu");
 
     return _outputs;
 }
 
-void Gelu::initialize_tiles() {
-    for (uint32_t N = 0; N < _outer_loop[0]; ++N) {
-        _tiles.push_back(initialize_instructions(N));
-    }
-}
+uint32_t Gelu::num_tiles() { return _outer_loop[0]; }
+
+Tile Gelu::make_tile(uint32_t idx) { return initialize_instructions(idx); }
 
 // table lookup
 Tile Gelu::initialize_instructions(uint32_t N) {
@@ -67,7 +65,7 @@ Tile Gelu::initialize_instructions(uint32_t N) {
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_activation_offset,
             .size = (uint32_t)activation_addrs.size() * _config.precision,
-            .src_addrs = std::move(activation_addrs),
+            .src_ranges = std::move(activation_addrs),
             .operand_id = _INPUT_OPERAND,
         });
 
@@ -84,7 +82,7 @@ Tile Gelu::initialize_instructions(uint32_t N) {
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_accumulation_offset,
             .size = (uint32_t)output_addrs.size() * _config.precision,
-            .src_addrs = std::move(output_addrs),
+            .src_ranges = std::move(output_addrs),
             .operand_id = _OUTPUT_OPERAND,
         });
     }
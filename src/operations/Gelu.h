@@ -7,6 +7,7 @@ class Gelu : public Operation {
     Gelu(std::string name);
 
     std::vector<Ptr<BTensor>> get_outputs(std::vector<Ptr<BTensor>> inputs);
+    uint32_t num_tiles() override;
 
    private:
     uint32_t _prod_batches;
@@ -17,7 +18,7 @@ class Gelu : public Operation {
     std::vector<uint32_t> _outer_loop;
 
     void calculate_loops();
-    void initialize_tiles();
+    Tile make_tile(uint32_t idx) override;
     Tile initialize_instructions(uint32_t N);
     uint32_t sram_size_needed();
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "GemmModel.h"
+
+double GemmModel::roofline_cycles(uint32_t B, uint32_t M, uint32_t K, uint32_t N) {
+    auto &config = Config::global_config;
+    // a weight-stationary array streams the rows once per core_height x core_width weight block
+    double k_blocks = (K + config.core_height - 1) / config.core_height;
+    double n_blocks = (N + config.core_width - 1) / config.core_width;
+    double compute = (double)B * k_blocks * n_blocks * std::max(M, 4u) /
+                     std::max(1u, config.systolic_array_count);
+
+    double elements = (double)B * M * K + (double)K * N + (double)B * M * N;
+    double bytes = elements * config.precision;
+    double bytes_per_cycle = (double)config.dram_channels * config.dram_req_size *
+                             config.dram_freq / config.core_freq;
+    return std::max(compute, bytes / bytes_per_cycle);
+}
+
+cycle_type GemmModel::cycles(std::string key, double roofline) {
+    auto it = _calibrations.find(key);
+    if (it == _calibrations.end() ||
+        it->second.samples < Config::global_config.analytical_gemm_samples) {
+        _sampled_ops++;
+        return 0;
+    }
+    _analytical_ops++;
+    auto &calibration = it->second;
+    return std::max((cycle_type)1,
+                    (cycle_type)std::ceil(roofline * calibration.measured / calibration.roofline));
+}
+
+void GemmModel::add_sample(std::string key, double roofline, cycle_type measured) {
+    auto &calibration = _calibrations[key];
+    calibration.samples++;
+    calibration.roofline += roofline;
+    calibration.measured += measured;
+    spdlog::info("GEMM model: {} sample {}, {} cycles, roofline {:.0f}", key,
+                 calibration.samples, measured, roofline);
+}
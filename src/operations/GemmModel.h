@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../Common.h"
+
+// Analytical cost of weight GEMMs (QKVGen, Projection, FC1/FC2) for analytical_gemm mode.
+//
+// The first analytical_gemm_samples MatMuls of every weight shape are simulated cycle-accurately
+// and compared to their roofline estimate. From then on MatMuls of that shape, whatever their
+// number of rows, run as a single tile that holds the systolic array for the roofline estimate
+// scaled by the measured/roofline ratio of the samples, without instructions or DRAM traffic.
+class GemmModel : public Singleton<GemmModel> {
+   private:
+    friend class Singleton;
+    GemmModel() = default;
+    ~GemmModel() = default;
+
+   public:
+    // core cycles of B x (M,K) x (K,N) if only the systolic arrays or only DRAM bandwidth
+    // limited it
+    double roofline_cycles(uint32_t B, uint32_t M, uint32_t K, uint32_t N);
+    // calibrated cycles, 0 while the shape still needs cycle-accurate samples
+    cycle_type cycles(std::string key, double roofline);
+    void add_sample(std::string key, double roofline, cycle_type measured);
+
+    uint64_t _analytical_ops = 0;
+    uint64_t _sampled_ops = 0;
+
+   private:
+    struct Calibration {
+        uint32_t samples = 0;
+        double roofline = 0;
+        double measured = 0;
+    };
+    robin_hood::unordered_map<std::string, Calibration> _calibrations;
+};
@@ -39,7 +39,7 @@ std::vector<Ptr<BTensor>> LayerNorm::get_outputs(std::vector<Ptr<BTensor>> input
         std::make_shared<NPUTensor>(_name + "_output", input_dims, NPUTensorBufType::ACT, false);
 
     calculate_loops();
-    initialize_tiles();
+    lookup_tile_cache("LayerNorm");
 
     spdlog::info("input dims : {} {} {}", _inputs[0]->get_dims(), _inputs[1]->get_dims(),
                  _inputs[2]->get_dims());
@@ -53,11 +53,9 @@ std::vector<Ptr<BTensor>> LayerNorm::get_outputs(std::vector<Ptr<BTensor>> input
 // else : N * C (multiplication^2)
 // out  : N * C
 // sum  : C * (2 + 3 * N)
-void LayerNorm::initialize_tiles() {
-    for (uint32_t N = 0; N < _outer_loop[0]; ++N) {
-        _tiles.push_back(initialize_instructions(N));
-    }
-}
+uint32_t LayerNorm::num_tiles() { return _outer_loop[0]; }
+
+Tile LayerNorm::make_tile(uint32_t idx) { return initialize_instructions(idx); }
 
 // layernorm:
 //  load affine gamma, beta, input
@@ -124,26 +122,26 @@ Tile LayerNorm::initialize_instructions(uint32_t N) {
         auto beta_tensor = std::static_pointer_cast<NPUTensor>(_inputs[2]);
         // std::set<addr_type> beta_addrs =
         // beta_tensor->calculate_dram_addresses({});
-        std::vector<addr_type> beta_addrs = beta_tensor->get_all_addrs();
+        AddrRanges beta_addrs = beta_tensor->get_all_addrs();
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_beta_base,
             // assume broadcasting bias is available inside the npu
             .size = (uint32_t)beta_addrs.size() * _config.precision,
-            .src_addrs = std::move(beta_addrs),
+            .src_ranges = std::move(beta_addrs),
             .operand_id = _INPUT_OPERAND + 2,
         });
     }
 
     // std::set<addr_type> gamma_addrs =
     // gamma_tensor->calculate_dram_addresses({});
-    std::vector<addr_type> gamma_addrs = gamma_tensor->get_all_addrs();
+    AddrRanges gamma_addrs = gamma_tensor->get_all_addrs();
     tile.instructions.push_back(Instruction{
         .opcode = Opcode::MOVIN,
         .dest_addr = sram_gamma_base,
         // assume broadcasting bias is available inside the npu
         .size = (uint32_t)gamma_addrs.size() * _config.precision,
-        .src_addrs = std::move(gamma_addrs),
+        .src_ranges = std::move(gamma_addrs),
         .operand_id = _INPUT_OPERAND + 1,
     });
 
@@ -157,7 +155,7 @@ Tile LayerNorm::initialize_instructions(uint32_t N) {
 
         // -- activation --
         uint32_t row_idx = n_outer_offset + n_inner_offset;
-        std::vector<addr_type> activation_addrs = activation_tensor->get_row_addrs(row_idx);
+        AddrRanges activation_addrs = activation_tensor->get_row_addrs(row_idx);
 
         if (activation_addrs.size() == 0)
             spdlog::info(
@@ -169,7 +167,7 @@ Tile LayerNorm::initialize_instructions(uint32_t N) {
                 .opcode = Opcode::MOVIN,
                 .dest_addr = sram_activation_offset,
                 .size = (uint32_t)activation_addrs.size() * _config.precision,
-                .src_addrs = std::move(activation_addrs),
+                .src_ranges = std::move(activation_addrs),
                 .operand_id = _INPUT_OPERAND,
             });
 
@@ -182,13 +180,13 @@ Tile LayerNorm::initialize_instructions(uint32_t N) {
                 std::vector<addr_type>{sram_activation_offset, sram_gamma_base, sram_beta_base},
         });
         // -- save outputs --
-        std::vector<addr_type> output_addrs =
+        AddrRanges output_addrs =
             output_tensor->get_row_addrs(n_outer_offset + n_inner_offset);
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_accumulation_offset,
             .size = (uint32_t)output_addrs.size() * _config.precision,
-            .src_addrs = std::move(output_addrs),
+            .src_ranges = std::move(output_addrs),
             .operand_id = _OUTPUT_OPERAND,
         });
     }
@@ -10,6 +10,7 @@ class LayerNorm : public Operation {
     //                      std::string name,
     //                      std::vector<uint32_t> weight_tensors);
     std::vector<Ptr<BTensor>> get_outputs(std::vector<Ptr<BTensor>> inputs) override;
+    uint32_t num_tiles() override;
 
    private:
     std::vector<uint32_t> _weight_dim;
@@ -21,7 +22,7 @@ class LayerNorm : public Operation {
     std::vector<uint32_t> _outer_loop;
 
     void calculate_loops();
-    void initialize_tiles();
+    Tile make_tile(uint32_t idx) override;
     Tile initialize_instructions(uint32_t N);
     uint32_t sram_size_needed();
 };
\ No newline at end of file
@@ -31,6 +31,7 @@ MatMul::MatMul(std::string name, std::vector<Ptr<NPUTensor>> weights) : Operatio
 
     // xxx: currently, it always shows better performance if _is_transposed is true.
     _is_transposed = true;
+    _has_weights = true;
 }
 
 MatMul::MatMul(std::string name) : Operation(name) { _inputs.resize(2); }
@@ -85,6 +86,22 @@ std::vector<Ptr<BTensor>> MatMul::get_outputs(std::vector<Ptr<BTensor>> inputs)
 
     calculate_loops();
     initialize_tiles();
+    _tp_ways = tp_split();
+    if (_config.analytical_gemm && _has_weights) {
+        // a core of a K split multiplies its 1/_tp_ways share of K
+        auto gemm_model = GemmModel::GetInstance();
+        uint32_t k = *input0_dims.rbegin();
+        _gemm_key = fmt::format("{} {} tp{}", input1_dims, _is_transposed, _tp_ways);
+        _roofline_cycles =
+            gemm_model->roofline_cycles(_prod_batches, *(output_dims.rbegin() + 1),
+                                        (k + _tp_ways - 1) / _tp_ways, *input1_dims.rbegin());
+        _analytical_cycles = gemm_model->cycles(_gemm_key, _roofline_cycles);
+    }
+    if (_analytical_cycles == 0) {
+        initialize_reduce_tiles();
+        lookup_tile_cache("MatMul", {_is_transposed, _use_row_override ? _row_count_override : 0,
+                                     _tp_ways});
+    }
 
     spdlog::info("input0 : {}  / input1: {} / output0 : {}", input0_dims, input1_dims, output_dims);
     spdlog::info("outer loop : {} / inner loop : {}", _outer_loop, _inner_loop);
@@ -92,6 +109,7 @@ std::vector<Ptr<BTensor>> MatMul::get_outputs(std::vector<Ptr<BTensor>> inputs)
     return _outputs;
 }
 
+// Only picks the loop order, tiles are built by make_tile as the scheduler asks for them.
 void MatMul::initialize_tiles() {
     // Here, B does not refer to batch_size,
     // but rather to the outer dimensions of the tensor in matmul,
@@ -116,32 +134,172 @@ void MatMul::initialize_tiles() {
         spdlog::info("MatMul LOOP OPTIMIZATION: K-tiles ({}) >> M-tiles ({}) and N-tiles ({})",
                     k_tiles, m_tiles, n_tiles);
         spdlog::info("  Using K-optimized loop order: M → K → N (innermost) for better data reuse");
-        
-        // K-optimized order: iterate M → K → N
-        for (uint32_t B = 0; B < _prod_batches; ++B) {
-            for (uint32_t M = 0; M < _outer_loop[0]; ++M) {
-                for (uint32_t K = 0; K < _outer_loop[1]; ++K) {
-                    for (uint32_t N = 0; N < _outer_loop[2]; ++N) {
-                        // Still accumulate over K, store after last K iteration
-                        _tiles.push_back(initialize_instructions(B, M, K, N, K + 1 == _outer_loop[1]));
-                    }
-                }
-            }
-        }
     } else {
         spdlog::info("MatMul: Using standard loop order: M → N → K (innermost)");
-        
-        // Standard order: iterate M → N → K
-        for (uint32_t B = 0; B < _prod_batches; ++B) {
-            for (uint32_t M = 0; M < _outer_loop[0]; ++M) {
-                for (uint32_t N = 0; N < _outer_loop[2]; ++N) {
-                    for (uint32_t K = 0; K < _outer_loop[1]; ++K) {
-                        _tiles.push_back(initialize_instructions(B, M, K, N, K + 1 == _outer_loop[1]));
-                    }
-                }
-            }
+    }
+    _k_optimized_order = use_k_optimized_order;
+}
+
+// K tiles are split over the cores of a row-parallel GEMM
+uint32_t MatMul::tp_split() {
+    auto output_dims = _outputs[0]->get_dims();
+    if (!_row_parallel || !_config.tp_row_parallel || output_dims.size() != 2) return 1;
+    // a divisor of num_cores, so tile_core spreads the output tiles over every core
+    uint32_t ways = std::max(1u, std::min(_config.num_cores, _outer_loop[1]));
+    while (_config.num_cores % ways != 0) ways--;
+    return ways;
+}
+
+// Reduce-scatter through DRAM: every way stores its partial sum to its own buffer, then every
+// core adds up the _tp_ways partial sums of its share of the output rows, in chunks filling half
+// the scratchpad, once all partial sums are stored.
+void MatMul::initialize_reduce_tiles() {
+    if (_tp_ways <= 1) return;
+    auto output_dims = _outputs[0]->get_dims();
+    for (uint32_t way = 0; way < _tp_ways; way++) {
+        _partial_sums.push_back(std::make_shared<NPUTensor>(
+            fmt::format("{}_partial_sum{}", _name, way), output_dims, NPUTensorBufType::ACT,
+            false));
+    }
+
+    uint32_t rows = output_dims[0];
+    uint32_t row_size = _tp_ways * output_dims[1] * _config.precision;
+    uint32_t chunk_rows = std::max(1u, (uint32_t)(_config.spad_size KB / 2 / row_size));
+    uint32_t share = (rows + _config.num_cores - 1) / _config.num_cores;
+    for (uint32_t core = 0; core < _config.num_cores; core++) {
+        uint32_t end = std::min(rows, (core + 1) * share);
+        if (core * share >= end) break;
+        _reduce_tiles.push_back(ReduceTile{.core = core, .row = 0, .rows = 0});
+        for (uint32_t row = core * share; row < end; row += chunk_rows) {
+            _reduce_tiles.push_back(
+                ReduceTile{.core = core, .row = row, .rows = std::min(chunk_rows, end - row)});
+        }
+    }
+    spdlog::info("MatMul {}: K split {} ways, {} reduce tiles", _name, _tp_ways,
+                 _reduce_tiles.size());
+}
+
+uint32_t MatMul::num_gemm_tiles() {
+    return _prod_batches * _outer_loop[0] * _outer_loop[1] * _outer_loop[2];
+}
+
+uint32_t MatMul::num_tiles() {
+    if (_analytical_cycles > 0) return _config.num_cores;
+    return num_gemm_tiles() + _reduce_tiles.size();
+}
+
+// cycle-accurate weight GEMMs calibrate GemmModel
+void MatMul::set_finish() {
+    Operation::set_finish();
+    if (!_gemm_key.empty() && _analytical_cycles == 0) {
+        GemmModel::GetInstance()->add_sample(_gemm_key, _roofline_cycles,
+                                             _stat.end_cycle - _stat.start_cycle);
+    }
+}
+
+// tiles are built in loop order B → M → N → K (innermost), or B → M → K → N if K-optimized.
+void MatMul::decode_tile_index(uint32_t idx, uint32_t &B, uint32_t &M, uint32_t &K, uint32_t &N) {
+    if (_k_optimized_order) {
+        N = idx % _outer_loop[2];
+        idx /= _outer_loop[2];
+        K = idx % _outer_loop[1];
+        idx /= _outer_loop[1];
+    } else {
+        K = idx % _outer_loop[1];
+        idx /= _outer_loop[1];
+        N = idx % _outer_loop[2];
+        idx /= _outer_loop[2];
+    }
+    M = idx % _outer_loop[0];
+    B = idx / _outer_loop[0];
+}
+
+// The K tiles of an output tile stay on one core, or on _tp_ways cores if row-parallel.
+uint32_t MatMul::tile_core(uint32_t idx) {
+    if (_analytical_cycles > 0) return idx;  // every core holds its SA for the estimate
+    if (idx >= num_gemm_tiles()) return _reduce_tiles[idx - num_gemm_tiles()].core;
+
+    uint32_t B, M, K, N;
+    decode_tile_index(idx, B, M, K, N);
+    uint32_t output_tile = (B * _outer_loop[0] + M) * _outer_loop[2] + N;
+    return K % _tp_ways + _tp_ways * (output_tile % (_config.num_cores / _tp_ways));
+}
+
+// Still accumulate over K, store after last K iteration. A row-parallel core accumulates every
+// _tp_ways-th K tile into its own partial sum.
+Tile MatMul::make_tile(uint32_t idx) {
+    if (_analytical_cycles > 0) {
+        return Tile{
+            .status = Tile::Status::INITIALIZED,
+            .optype = get_name(),
+            .operation_id = _id,
+            .accum = false,
+            .analytical_cycles = _analytical_cycles,
+        };
+    }
+    if (idx >= num_gemm_tiles())
+        return initialize_reduce_instructions(_reduce_tiles[idx - num_gemm_tiles()]);
+
+    uint32_t B, M, K, N;
+    decode_tile_index(idx, B, M, K, N);
+    Tile tile = initialize_instructions(B, M, K, N, K + _tp_ways >= _outer_loop[1]);
+    tile.accum = K >= _tp_ways;
+    return tile;
+}
+
+// load the _tp_ways partial sums of the rows, add them up and store the result
+Tile MatMul::initialize_reduce_instructions(const ReduceTile &reduce) {
+    auto tile = Tile{
+        .status = Tile::Status::INITIALIZED,
+        .optype = get_name(),
+        .operation_id = _id,
+        .batch = reduce.row,
+        .K = 0,
+        .accum = false,
+    };
+    if (reduce.rows == 0) {
+        tile.status = Tile::Status::BAR;
+        tile.barrier_tiles = num_gemm_tiles();
+        return tile;
+    }
+
+    auto output_tensor = std::static_pointer_cast<NPUTensor>(_outputs[0]);
+    AddrRanges output_addrs;
+    for (uint32_t row = reduce.row; row < reduce.row + reduce.rows; row++) {
+        output_addrs.append(output_tensor->get_row_addrs(row));
+    }
+    uint32_t elements = output_addrs.size();
+
+    std::vector<addr_type> partial_sum_offsets;
+    for (uint32_t way = 0; way < _tp_ways; way++) {
+        addr_type sram_offset = SPAD_BASE + way * elements * _config.precision;
+        partial_sum_offsets.push_back(sram_offset);
+        AddrRanges partial_sum_addrs;
+        for (uint32_t row = reduce.row; row < reduce.row + reduce.rows; row++) {
+            partial_sum_addrs.append(_partial_sums[way]->get_row_addrs(row));
         }
+        tile.instructions.push_back(Instruction{
+            .opcode = Opcode::MOVIN,
+            .dest_addr = sram_offset,
+            .size = elements * _config.precision,
+            .src_ranges = std::move(partial_sum_addrs),
+            .operand_id = _INPUT_OPERAND,
+        });
     }
+    tile.instructions.push_back(Instruction{
+        .opcode = Opcode::ADD,
+        .dest_addr = ACCUM_SPAD_BASE,
+        .size = (_tp_ways - 1) * elements,
+        .src_addrs = std::move(partial_sum_offsets),
+    });
+    tile.instructions.push_back(Instruction{
+        .opcode = Opcode::MOVOUT,
+        .dest_addr = ACCUM_SPAD_BASE,
+        .size = elements * _config.precision,
+        .src_ranges = std::move(output_addrs),
+        .operand_id = _OUTPUT_OPERAND,
+    });
+    return tile;
 }
 
 Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_t N,
@@ -179,7 +337,9 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
 
     auto activation_tensor = std::static_pointer_cast<NPUTensor>(_inputs[0]);
     auto weight_tensor = std::static_pointer_cast<NPUTensor>(_inputs[1]);
-    auto output_tensor = std::static_pointer_cast<NPUTensor>(_outputs[0]);
+    // a K split stores the partial sum of way K % _tp_ways
+    auto output_tensor = std::static_pointer_cast<NPUTensor>(
+        _tp_ways > 1 ? _partial_sums[K % _tp_ways] : _outputs[0]);
 
     if (_is_transposed) {
         std::swap(activation_tensor, weight_tensor);
@@ -213,7 +373,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
         
         for (uint32_t n_inner_offset = 0; n_inner_offset < effective_n_inner; n_inner_offset += loop_size) {
             // n_inner_offset: L1 tile start index in each L2 tile
-            std::vector<addr_type> bias_addrs;
+            AddrRanges bias_addrs;
             uint32_t remaining = std::min(loop_size, effective_n_inner - n_inner_offset);
             
             for (uint32_t n_loop = 0; n_loop < remaining; ++n_loop) {
@@ -234,7 +394,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                     .size = (uint32_t)bias_addrs.size() * _config.precision,  // assume broadcasting
                                                                               // bias is
                     // available inside the npu
-                    .src_addrs = std::move(bias_addrs),
+                    .src_ranges = std::move(bias_addrs),
                     .operand_id = _INPUT_OPERAND + 2,
                 });
             }
@@ -270,7 +430,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                 if (n_inner_offset == 0) {
                     // During the n_inner tile iterations (to prevent duplication),
                     // add the MOVIN instruction only in the first inner loop.
-                    std::vector<addr_type> activation_addrs;
+                    AddrRanges activation_addrs;
                     for (int m_loop = 0; m_loop < loop_size; m_loop++) {
                         for (int k_loop = 0; k_loop < loop_size; k_loop++) {
                             std::vector<uint32_t> activation_indexes(batch_index);
@@ -307,7 +467,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                             .opcode = Opcode::MOVIN,
                             .dest_addr = sram_activation_offset,
                             .size = (uint32_t)activation_addrs.size() * _config.precision,
-                            .src_addrs = std::move(activation_addrs),
+                            .src_ranges = std::move(activation_addrs),
                             .operand_id = _INPUT_OPERAND});
                     }
                 } else {
@@ -333,7 +493,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                 if (m_inner_offset == 0) {
                     // During the m_inner tile iterations (to prevent duplication),
                     // add the MOVIN instruction only in the first inner loop.
-                    std::vector<addr_type> weight_addrs;
+                    AddrRanges weight_addrs;
                     for (int k_loop = 0; k_loop < loop_size; k_loop++) {
                         for (int n_loop = 0; n_loop < loop_size; n_loop++) {
                             std::vector<uint32_t> weight_indexes(batch_index);
@@ -372,7 +532,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                             .opcode = Opcode::MOVIN,
                             .dest_addr = sram_weight_offset,
                             .size = (uint32_t)weight_addrs.size() * _config.precision,
-                            .src_addrs = std::move(weight_addrs),
+                            .src_ranges = std::move(weight_addrs),
                             .operand_id = _INPUT_OPERAND + 1,
                         });
                     }
@@ -418,7 +578,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                 // when iterating inner_loop k times,
                 // store L1 tile to output
                 if (should_store && (k_inner_offset + loop_size >= k_inner)) {
-                    std::vector<addr_type> output_addrs;
+                    AddrRanges output_addrs;
                     for (int n_loop = 0; n_loop < loop_size; n_loop++) {
                         for (int m_loop = 0; m_loop < loop_size; m_loop++) {
                             std::vector<uint32_t> output_indexes(batch_index);
@@ -434,7 +594,7 @@ Tile MatMul::initialize_instructions(uint32_t B, uint32_t M, uint32_t K, uint32_
                         .opcode = Opcode::MOVOUT,
                         .dest_addr = sram_accumulation_offset,
                         .size = (uint32_t)output_addrs.size() * _config.precision,
-                        .src_addrs = std::move(output_addrs),
+                        .src_ranges = std::move(output_addrs),
                         .operand_id = _OUTPUT_OPERAND,
                     });
                 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "../tensor/NPUTensor.h"
+#include "GemmModel.h"
 #include "Operation.h"
 
 class MatMul : public Operation {
@@ -12,7 +13,12 @@ class MatMul : public Operation {
     //                std::vector<uint32_t> weight_tensors);
 
     std::vector<Ptr<BTensor>> get_outputs(std::vector<Ptr<BTensor>> inputs);
+    uint32_t num_tiles() override;
+    void set_finish() override;
     void set_transposed() { _is_transposed = true; }
+    // Megatron row-parallel layer (projection, FC2): with tp_row_parallel, K is split over the
+    // cores and the partial sums are all-reduced
+    void set_row_parallel() { _row_parallel = true; }
     
     // MoE optimization: Override number of rows to process (for token slicing)
     void set_row_count_override(uint32_t row_count) { 
@@ -42,8 +48,35 @@ class MatMul : public Operation {
     bool _use_row_override = false;
     uint32_t _row_count_override = 0;
 
+    bool _k_optimized_order;
+
+    // analytical_gemm: weight GEMMs are sampled cycle-accurately, then costed by GemmModel
+    bool _has_weights = false;
+    std::string _gemm_key;
+    double _roofline_cycles = 0;
+    cycle_type _analytical_cycles = 0;
+
+    // tensor parallelism over the SA cores: output tiles are spread over the cores, a row-parallel
+    // GEMM also splits K into _tp_ways partial sums that its reduce tiles add up
+    struct ReduceTile {
+        uint32_t core;
+        uint32_t row;
+        uint32_t rows;  // 0: barrier, waits for every GEMM tile
+    };
+    bool _row_parallel = false;
+    uint32_t _tp_ways = 1;
+    std::vector<Ptr<NPUTensor>> _partial_sums;  // one per way, reduced into the output
+    std::vector<ReduceTile> _reduce_tiles;      // after the GEMM tiles
+
     void calculate_loops();
     void initialize_tiles();
+    uint32_t tp_split();
+    void initialize_reduce_tiles();
+    uint32_t num_gemm_tiles();
+    void decode_tile_index(uint32_t idx, uint32_t &B, uint32_t &M, uint32_t &K, uint32_t &N);
+    uint32_t tile_core(uint32_t idx) override;
+    Tile make_tile(uint32_t idx) override;
+    Tile initialize_reduce_instructions(const ReduceTile &reduce);
     Tile initialize_instructions(uint32_t B, uint32_t N, uint32_t K, uint32_t M, bool should_store);
     uint32_t sram_size_needed();
 };
\ No newline at end of file
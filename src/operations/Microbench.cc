@@ -100,7 +100,7 @@ Tile Microbench::initialize_instructions() {
         }
 
         // LOAD
-        std::vector<uint64_t> activation_addrs;
+        AddrRanges activation_addrs;
         for (int load_idx = 0; load_idx < load_iteration; load_idx++) {
             int banks_per_channel = 16;
 
@@ -122,7 +122,7 @@ Tile Microbench::initialize_instructions() {
                 .opcode = Opcode::MOVIN,
                 .dest_addr = sram_load_entry.first,
                 .size = sram_load_entry.second,
-                .src_addrs = activation_addrs,
+                .src_ranges = std::move(activation_addrs),
                 .operand_id = _INPUT_OPERAND,
             });
         }
@@ -142,11 +142,13 @@ Tile Microbench::initialize_instructions() {
         });
 
         uint32_t movout_addr = AddressConfig::make_address(ch, 0, 0, 0, 0, 0);
+        AddrRanges movout_addrs;
+        movout_addrs.push_back(movout_addr);
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_accum_entry.first,
             .size = sram_accum_entry.second,
-            .src_addrs = std::vector<addr_type>{movout_addr},
+            .src_ranges = std::move(movout_addrs),
         });
 
         // COMPUTE with gemv data
@@ -162,11 +164,13 @@ Tile Microbench::initialize_instructions() {
         });
 
         uint32_t gemv_movout_addr = AddressConfig::make_address(ch, 1, 0, 0, 0, 0);
+        AddrRanges gemv_movout_addrs;
+        gemv_movout_addrs.push_back(gemv_movout_addr);
         tile.instructions.push_back(Instruction{
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_gemv_accum_entry.first,
             .size = sram_gemv_accum_entry.second,
-            .src_addrs = std::vector<addr_type>{gemv_movout_addr},
+            .src_ranges = std::move(gemv_movout_addrs),
         });
     }
 
@@ -44,23 +44,18 @@ std::vector<Ptr<BTensor>> NeuPIMSAttend::get_outputs(std::vector<Ptr<BTensor>> i
 
     // todo tiling and instruction initialization.
     calculate_loops();
-    initialize_tiles();
+    assert(!_req_idxs.empty() && _req_idxs.back() == _batch_size - 1);
 
     spdlog::info("output dim (batch size): {}", _batch_size);
 
     return _outputs;
 }
 
-void NeuPIMSAttend::initialize_tiles() {
-    int num_npu_tiles = _req_idxs.size();
-    int prev_idx = 0;
-    for (int i = 0; i < num_npu_tiles; i++) {
-        int req_idx = _req_idxs[i];
-        if (i == num_npu_tiles - 1) assert(req_idx == _batch_size - 1);
+uint32_t NeuPIMSAttend::num_tiles() { return _req_idxs.size(); }
 
-        _tiles.push_back(initialize_instructions(prev_idx, req_idx));
-        prev_idx = req_idx;
-    }
+// tile idx covers requests _req_idxs[idx - 1] to _req_idxs[idx]
+Tile NeuPIMSAttend::make_tile(uint32_t idx) {
+    return initialize_instructions(idx == 0 ? 0 : _req_idxs[idx - 1], _req_idxs[idx]);
 }
 
 Tile NeuPIMSAttend::initialize_instructions(int start, int end) {
@@ -88,8 +83,8 @@ Tile NeuPIMSAttend::initialize_instructions(int start, int end) {
             assert(logit->get_dims()[1] == seq_len);
 
             for (int h_idx = 0; h_idx < _nh; h_idx++) {
-                std::vector<addr_type> dram_logit_addrs;
-                std::vector<addr_type> dram_value_addrs;
+                AddrRanges dram_logit_addrs;
+                AddrRanges dram_value_addrs;
 
                 for (int dk_idx = 0; dk_idx < _dk; dk_idx++) {
                     for (int seq_idx = 0; seq_idx < seq_len; seq_idx++) {
@@ -110,14 +105,14 @@ Tile NeuPIMSAttend::initialize_instructions(int start, int end) {
                     .opcode = Opcode::MOVIN,
                     .dest_addr = sram_l_entry.first,
                     .size = sram_l_entry.second,
-                    .src_addrs = dram_logit_addrs,
+                    .src_ranges = std::move(dram_logit_addrs),
                     .operand_id = _INPUT_OPERAND  // logit
                 });
                 tile.instructions.push_back(Instruction{
                     .opcode = Opcode::MOVIN,
                     .dest_addr = sram_v_entry.first,
                     .size = sram_v_entry.second,
-                    .src_addrs = dram_value_addrs,
+                    .src_ranges = std::move(dram_value_addrs),
                     .operand_id = _INPUT_OPERAND  // logit
                 });
 
@@ -139,7 +134,7 @@ Tile NeuPIMSAttend::initialize_instructions(int start, int end) {
                     .opcode = Opcode::MOVOUT,
                     .dest_addr = sram_a_entry.first,
                     .size = sram_a_entry.second,
-                    .src_addrs = std::static_pointer_cast<NPUTensor>(_outputs[i])
+                    .src_ranges = std::static_pointer_cast<NPUTensor>(_outputs[i])
                                      ->_inners[h_idx]
                                      ->get_all_addrs(),
                     .operand_id = _OUTPUT_OPERAND,
@@ -256,7 +251,7 @@ Tile NeuPIMSAttend::initialize_instructions(int start, int end) {
                         .opcode = Opcode::MOVOUT,
                         .dest_addr = sram_acc_entry.first,
                         .size = sram_acc_entry.second,
-                        .src_addrs = std::static_pointer_cast<NPUTensor>(_outputs[i])
+                        .src_ranges = std::static_pointer_cast<NPUTensor>(_outputs[i])
                                          ->_inners[hi]
                                          ->get_all_addrs(),
                         .operand_id = _OUTPUT_OPERAND,
@@ -53,7 +53,7 @@ std::vector<Ptr<BTensor>> NeuPIMSLogitSoftmax::get_outputs(std::vector<Ptr<BTens
 
     // todo tiling and instruction initialization.
     calculate_loops();
-    initialize_tiles();
+    assert(!_req_idxs.empty() && _req_idxs.back() == _batch_size - 1);
 
     // spdlog::info("input dims : {} {}", Q->get_dims(), K->get_dims());
     spdlog::info("output dim : {}", _batch_size);
@@ -61,17 +61,11 @@ std::vector<Ptr<BTensor>> NeuPIMSLogitSoftmax::get_outputs(std::vector<Ptr<BTens
     return _outputs;
 }
 
-void NeuPIMSLogitSoftmax::initialize_tiles() {
-    int num_npu_tiles = _req_idxs.size();
-    int prev_idx = 0;
-    for (int i = 0; i < num_npu_tiles; i++) {
-        int req_idx = _req_idxs[i];
-        if (i == num_npu_tiles - 1) {
-            assert(req_idx == _batch_size - 1);
-        }
-        _tiles.push_back(initialize_instructions(prev_idx, req_idx));
-        prev_idx = req_idx;
-    }
+uint32_t NeuPIMSLogitSoftmax::num_tiles() { return _req_idxs.size(); }
+
+// tile idx covers requests _req_idxs[idx - 1] to _req_idxs[idx]
+Tile NeuPIMSLogitSoftmax::make_tile(uint32_t idx) {
+    return initialize_instructions(idx == 0 ? 0 : _req_idxs[idx - 1], _req_idxs[idx]);
 }
 
 Tile NeuPIMSLogitSoftmax::initialize_instructions(int start, int end) {
@@ -101,8 +95,8 @@ Tile NeuPIMSLogitSoftmax::initialize_instructions(int start, int end) {
             assert(seq_len == key->get_dims()[2]);
 
             for (int h_idx = 0; h_idx < _nh; h_idx++) {
-                std::vector<addr_type> dram_query_addrs;
-                std::vector<addr_type> dram_key_addrs;
+                AddrRanges dram_query_addrs;
+                AddrRanges dram_key_addrs;
 
                 for (int dk_idx = 0; dk_idx < _dk; dk_idx++) {
                     for (int seq_idx = 0; seq_idx < seq_len; seq_idx++) {
@@ -123,14 +117,14 @@ Tile NeuPIMSLogitSoftmax::initialize_instructions(int start, int end) {
                     .opcode = Opcode::MOVIN,
                     .dest_addr = sram_q_entry.first,
                     .size = sram_q_entry.second,
-                    .src_addrs = dram_query_addrs,
+                    .src_ranges = std::move(dram_query_addrs),
                     .operand_id = _INPUT_OPERAND,  // query
                 });
                 tile.instructions.push_back(Instruction{
                     .opcode = Opcode::MOVIN,
                     .dest_addr = sram_k_entry.first,
                     .size = sram_k_entry.second,
-                    .src_addrs = dram_key_addrs,
+                    .src_ranges = std::move(dram_key_addrs),
                     .operand_id = _INPUT_OPERAND + 1,  // key
                 });
 
@@ -160,7 +154,7 @@ Tile NeuPIMSLogitSoftmax::initialize_instructions(int start, int end) {
                     .opcode = Opcode::MOVOUT,
                     .dest_addr = sram_ls_entry.first,
                     .size = sram_ls_entry.second,
-                    .src_addrs = std::static_pointer_cast<NPUTensor>(_outputs[i])
+                    .src_ranges = std::static_pointer_cast<NPUTensor>(_outputs[i])
                                      ->_inners[h_idx]
                                      ->get_all_addrs(),
                     .operand_id = _OUTPUT_OPERAND,
@@ -285,7 +279,7 @@ Tile NeuPIMSLogitSoftmax::initialize_instructions(int start, int end) {
                 .opcode = Opcode::MOVOUT,
                 .dest_addr = sram_acc_entry.first,
                 .size = sram_acc_entry.second,
-                .src_addrs = std::static_pointer_cast<NPUTensor>(_outputs[i])
+                .src_ranges = std::static_pointer_cast<NPUTensor>(_outputs[i])
                                  ->_inners[hi]
                                  ->get_all_addrs(),  // TODO:
                 .operand_id = _OUTPUT_OPERAND,
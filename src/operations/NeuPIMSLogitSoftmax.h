@@ -8,6 +8,7 @@ class NeuPIMSLogitSoftmax : public Operation {
     NeuPIMSLogitSoftmax(std::string name);
 
     std::vector<Ptr<BTensor>> get_outputs(std::vector<Ptr<BTensor>> inputs) override;
+    uint32_t num_tiles() override;
 
     uint32_t _batch_size;
     std::vector<Ptr<NPUTensor>> _qs;
@@ -28,7 +29,7 @@ class NeuPIMSLogitSoftmax : public Operation {
     std::vector<int> _req_idxs;
 
     void calculate_loops();
-    void initialize_tiles();
+    Tile make_tile(uint32_t idx) override;
     Tile initialize_instructions(int start, int end);
     uint32_t sram_size_needed();
 
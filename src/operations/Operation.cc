@@ -2,7 +2,7 @@
 
 #include <memory>
 
-SimulationConfig Operation::_config;
+thread_local SimulationConfig Operation::_config;
 
 Operation::Operation(MappingTable mapping_table) {
     _id = generate_id();
@@ -81,6 +81,9 @@ Operation::Operation(const Operation &operation) {
     _finish = operation._finish;
     _attributes = operation._attributes;
     _tiles = operation._tiles;
+    _next_tile = operation._next_tile;
+    _next_core_tiles = operation._next_core_tiles;
+    _tile_cache = operation._tile_cache;
     _inputs = operation._inputs;
     _outputs = operation._outputs;
 }
@@ -115,4 +118,35 @@ bool Operation::check_executable() {
     return result;
 }
 
-std::deque<Tile> Operation::get_tiles() { return _tiles; }
\ No newline at end of file
+Tile Operation::next_tile() { return build_tile(_next_tile++); }
+
+bool Operation::has_next_tile(uint32_t core_id) {
+    if (_next_core_tiles.empty()) _next_core_tiles.assign(_config.num_cores, 0);
+    uint32_t &idx = _next_core_tiles[core_id];
+    while (idx < num_tiles() && tile_core(idx) != core_id) idx++;
+    return idx < num_tiles();
+}
+
+Tile Operation::next_tile(uint32_t core_id) {
+    ast(has_next_tile(core_id));
+    return build_tile(_next_core_tiles[core_id]++);
+}
+
+Tile Operation::build_tile(uint32_t idx) {
+    if (_tile_cache == nullptr) return make_tile(idx);
+
+    auto cache = TileCache::GetInstance();
+    auto cached = _tile_cache->tiles[idx];
+    Tile tile = cached != nullptr ? *cached : cache->add_tile(_tile_cache, idx, make_tile(idx));
+    tile.operation_id = _id;
+    tile.optype = get_name();
+    return tile;
+}
+
+// key: op type, attributes and the dims of every input and output tensor
+void Operation::lookup_tile_cache(std::string op_type, std::vector<uint32_t> attributes) {
+    std::string key = fmt::format("{} {}", op_type, attributes);
+    for (auto tensor : _inputs) key += fmt::format("/{}", tensor->get_dims());
+    for (auto tensor : _outputs) key += fmt::format("/{}", tensor->get_dims());
+    _tile_cache = TileCache::GetInstance()->lookup(key, num_tiles());
+}
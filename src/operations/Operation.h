@@ -4,6 +4,7 @@
 #include "../Mapping.h"
 #include "../Tensor.h"
 #include "../tensor/BTensor.h"
+#include "TileCache.h"
 
 class Model;
 class OpParser;
@@ -43,7 +44,14 @@ class Operation : public std::enable_shared_from_this<Operation> {
     virtual std::vector<std::shared_ptr<BTensor>> get_inputs() { return _inputs; }
     virtual uint32_t num_outputs() { return _outputs.size(); }
     virtual std::vector<std::shared_ptr<Operation>> get_child_nodes();
-    virtual std::deque<Tile> get_tiles();
+    // Tiles are handed to the scheduler one at a time. Operations overriding num_tiles() and
+    // make_tile() build each tile on demand, the others are tiled eagerly into _tiles.
+    virtual uint32_t num_tiles() { return _tiles.size(); }
+    bool has_next_tile() { return _next_tile < num_tiles(); }
+    Tile next_tile();
+    // multi-core: every SA core takes the tiles tile_core() assigns to it, in tile order
+    bool has_next_tile(uint32_t core_id);
+    Tile next_tile(uint32_t core_id);
     virtual bool check_executable();
     virtual std::vector<Ptr<BTensor>> get_outputs(std::vector<Ptr<BTensor>> inputs);
 
@@ -56,6 +64,11 @@ class Operation : public std::enable_shared_from_this<Operation> {
 
    protected:
     virtual void initialize_instructions(Tile &tile, Mapping mapping) {}
+    virtual Tile make_tile(uint32_t idx) { return std::move(_tiles[idx]); }
+    virtual uint32_t tile_core(uint32_t idx) { return idx % _config.num_cores; }
+    Tile build_tile(uint32_t idx);
+    // share tiles with the other instances of this shape (TileCache)
+    void lookup_tile_cache(std::string op_type, std::vector<uint32_t> attributes = {});
 
     static const uint32_t _NO_OPERAND = 0;
     static const uint32_t _INPUT_OPERAND = 100;
@@ -63,11 +76,14 @@ class Operation : public std::enable_shared_from_this<Operation> {
     uint32_t _id;
     std::string _name;
     std::string _optype;
-    static SimulationConfig _config;
+    static thread_local SimulationConfig _config;
     std::vector<Ptr<BTensor>> _inputs;
     std::vector<Ptr<BTensor>> _outputs;
     std::map<std::string, std::string> _attributes;
     std::deque<Tile> _tiles;
+    uint32_t _next_tile = 0;
+    std::vector<uint32_t> _next_core_tiles;  // per core, next index to check
+    Ptr<TileCache::Entry> _tile_cache;
     std::vector<std::vector<std::vector<addr_type>>> _weight_addrs;
     std::vector<std::vector<std::vector<std::vector<addr_type>>>> _input_addrs;
     std::vector<std::vector<std::vector<std::vector<addr_type>>>> _output_addrs;
@@ -193,7 +193,7 @@ Tile PIMGEMVAdd::initialize_instructions() {
                         .opcode = Opcode::MOVOUT,
                         .dest_addr = sram_acc_base,
                         .size = column_height,
-                        .src_addrs = std::static_pointer_cast<NPUTensor>(_outputs[i])
+                        .src_ranges = std::static_pointer_cast<NPUTensor>(_outputs[i])
                                          ->_inners[hi]
                                          ->get_all_addrs(),  // TODO:
                         .operand_id = _OUTPUT_OPERAND,
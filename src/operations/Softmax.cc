@@ -90,7 +90,7 @@ Tile Softmax::initialize_instructions(uint32_t N, uint32_t req_idx) {
             .opcode = Opcode::MOVIN,
             .dest_addr = sram_activation_offset,
             .size = (uint32_t)activation_addrs.size() * _config.precision,
-            .src_addrs = std::move(activation_addrs),
+            .src_ranges = std::move(activation_addrs),
             .operand_id = _INPUT_OPERAND,
         });
 
@@ -107,7 +107,7 @@ Tile Softmax::initialize_instructions(uint32_t N, uint32_t req_idx) {
             .opcode = Opcode::MOVOUT,
             .dest_addr = sram_accumulation_offset,
             .size = (uint32_t)output_addrs.size() * _config.precision,
-            .src_addrs = std::move(output_addrs),
+            .src_ranges = std::move(output_addrs),
             .operand_id = _OUTPUT_OPERAND,
         });
     }
@@ -0,0 +1,48 @@
+#include "TileCache.h"
+
+Ptr<TileCache::Entry> TileCache::lookup(std::string key, uint32_t num_tiles) {
+    auto &config = Config::global_config;
+    if (config.real_addresses || config.tile_cache_tiles == 0) return nullptr;
+
+    // tiling depends on the core config as well
+    key += fmt::format("/core {} {} {} {} {} {}", config.core_width, config.vector_core_width,
+                       config.spad_size, config.accum_spad_size, config.systolic_array_count,
+                       config.precision);
+
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        _entries.splice(_entries.end(), _entries, it->second);
+        _hits++;
+        ast(it->second->get()->tiles.size() == num_tiles);
+        return *it->second;
+    }
+
+    _misses++;
+    auto entry = std::make_shared<Entry>();
+    entry->key = key;
+    entry->tiles.resize(num_tiles);
+    _entries.push_back(entry);
+    _index[key] = std::prev(_entries.end());
+    return entry;
+}
+
+const Tile &TileCache::add_tile(Ptr<Entry> entry, uint32_t idx, Tile tile) {
+    ast(entry->tiles[idx] == nullptr);
+    entry->tiles[idx] = std::make_shared<const Tile>(std::move(tile));
+    if (entry->cached) {
+        entry->num_built++;
+        _num_tiles++;
+        evict();
+    }
+    return *entry->tiles[idx];
+}
+
+void TileCache::evict() {
+    while (_num_tiles > Config::global_config.tile_cache_tiles && !_entries.empty()) {
+        auto entry = _entries.front();
+        _entries.pop_front();
+        _index.erase(entry->key);
+        entry->cached = false;
+        _num_tiles -= entry->num_built;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <list>
+
+#include "../Common.h"
+
+// Tiles shared between operations of the same shape, built by the first instance that asks
+// for a tile and copied by the others.
+//
+// Apart from the DRAM addresses of MOVIN/MOVOUT, the tiles of MatMul, LayerNorm and Gelu only
+// depend on the op type, tensor dims and core config, which make up the key. The synthetic
+// address stream only uses the element count of those addresses, so a cached tile is reused
+// once rebound to the instance (operation id and name). With real_addresses, or a zero
+// tile_cache_tiles, every instance builds its own tiles.
+class TileCache : public Singleton<TileCache> {
+   private:
+    friend class Singleton;
+    TileCache() = default;
+    ~TileCache() = default;
+
+   public:
+    struct Entry {
+        std::string key;
+        std::vector<std::shared_ptr<const Tile>> tiles;  // null until built
+        uint32_t num_built = 0;
+        bool cached = true;  // false once evicted
+    };
+
+    // nullptr if tiles are not cached
+    Ptr<Entry> lookup(std::string key, uint32_t num_tiles);
+    const Tile &add_tile(Ptr<Entry> entry, uint32_t idx, Tile tile);
+
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+
+   private:
+    // least recently used first
+    std::list<Ptr<Entry>> _entries;
+    robin_hood::unordered_map<std::string, std::list<Ptr<Entry>>::iterator> _index;
+    uint64_t _num_tiles = 0;
+
+    void evict();
+};
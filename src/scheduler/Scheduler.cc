@@ -1,7 +1,10 @@
 #include "Scheduler.h"
 
 #include <cmath>
+#include <numeric>
 
+#include "../allocator/AddressAllocator.h"
+#include "../operations/GemmModel.h"
 #include "../tensor/NPUTensor.h"
 #include "../tensor/PIMTensor.h"
 
@@ -27,16 +30,49 @@ Scheduler::Scheduler(SimulationConfig config, const cycle_type* core_cycle)
     // 2: PIM Program
     _model_program1 = nullptr;
     _model_program2 = nullptr;
+    _executable_tile_queues1.resize(_config.num_cores);
 
     _init_stage = Stage::A;
     // _init_stage = Stage::C;
     _stage = _init_stage;
+    _sub_stage = first_sub_stage(_stage);
     _just_one_stage = false;
+    _breqs.resize(_config.sub_batch_mode ? _config.sub_batches : 2);
+    _sa_sub_batch = _pim_sub_batch = -1;
+    _round = 0;
+    _round_layer_pair = 0;
+    _round_sa_estimate = _round_pim_estimate = 0;
+    _sa_cycle_scale = _pim_cycle_scale = 1;
+    _stage_start_cycle = 0;
+    _stage_cycles = _sa_busy_cycles = _pim_busy_cycles = 0;
+
+    // pair p = C/D stages running Pj/FFNs of layer p and QKVgen of layer p+1
+    uint32_t n_pairs = _config.model_n_layer > 0 ? _config.model_n_layer - 1 : 0;
+    if (_config.layer_sim_mode == LayerSimMode::FULL) {
+        for (uint32_t p = 0; p < n_pairs; p++) _layer_pairs.push_back(p);
+    } else if (_config.layer_sim_mode == LayerSimMode::SAMPLED) {
+        // midpoints of k equal strata of the layer stack
+        uint32_t k = std::min(std::max(_config.sampled_layers, 1u), n_pairs);
+        for (uint32_t i = 0; i < k; i++) _layer_pairs.push_back((2 * i + 1) * n_pairs / (2 * k));
+    } else {
+        _layer_pairs.push_back(0);
+    }
+    _layer_pair_idx = 0;
+    _iteration = 0;
+    _joined_reqs = 0;
+    _preempted_reqs = 0;
+    _total_preemptions = 0;
+    _swapped_bytes = 0;
+    _migrated_reqs = 0;
+    _kv_copy_queues.resize(_dram_channels);
+    _recomputed_tokens = 0;
+    _prefix_hits = 0;
+    _prefix_rows_saved = 0;
+    _prefill_tokens_saved = 0;
+    _cow_rows = 0;
 
     _has_stage_changed = false;
 
-    _partition_alg_simple = true;
-
     // Request queue for channel
     for (int i = 0; i < _dram_channels; i++) {
         auto req_q = std::vector<Ptr<InferRequest>>();
@@ -49,7 +85,9 @@ Scheduler::Scheduler(SimulationConfig config, const cycle_type* core_cycle)
     }
 
     // KV allocate by pim tile
-    int model_weight = _config.model_params_b * _config.precision / _config.n_tp;  // GB
+    // a pipeline stage holds 1/n_pp of the layers
+    uint32_t weight_shards = _config.n_tp * (_config.pipeline_parallel ? _config.n_pp : 1);
+    int model_weight = _config.model_params_b * _config.precision / weight_shards;  // GB
     int memory_capacity = _dram_channels;                                          // GB
     int available_for_kv = memory_capacity - model_weight;                         // GB
     int pim_tile_size = _config.dram_page_size * _dram_banks_per_ch;               // B
@@ -169,6 +207,12 @@ int Scheduler::allocate_pim_tile(uint32_t seq_len) {
 
 void Scheduler::allocate_requests() {
     uint32_t batch_size = 0;
+    auto alloc = KVCacheAlloc::GetInstance();
+
+    // running requests get the rows of their next token before new ones are admitted
+    grow_kv_caches();
+    if (_config.kv_migration) migrate_kv_caches();
+    if (_config.online_ch_balancing) predict_channel_latencys();
 
     // if (_ch_load_balancing) {
     //     // sort request_queue by sequence length
@@ -185,12 +229,17 @@ void Scheduler::allocate_requests() {
         assert(request->output_size > request->generated);
 
         if (!request->is_initiated) {
+            // a request follows its prompt prefix to the channel that caches it
+            if (_ch_load_balancing && !_config.online_ch_balancing && request->prefix_hash != 0) {
+                int shared_ch = alloc->find_shared_channel(request->prefix_hash);
+                if (shared_ch >= 0) request->channel = shared_ch;
+            }
             int ch = request->channel;
             assert(ch < _dram_channels);
             spdlog::info("request#{} seq_len:{} channel:{}", request->id, request->input_size,
                          request->channel);
             // allocate_pim_tile(request->input_size);
-            if (ch == -1) continue;
+            if (ch == -1 && !_config.online_ch_balancing) continue;
 
             uint32_t seq_len = request->input_size;
 
@@ -198,17 +247,46 @@ void Scheduler::allocate_requests() {
             std::vector<uint32_t> dim_value{_nh, seq_len, _dk};
 
             if (_active_reqs >= _max_active_reqs) continue;
+            if (request->swap_ready_cycle > _cycles) continue;
+            if (_config.online_ch_balancing) {
+                if (place_request(request) < 0) {
+                    if (_active_reqs == 0) {
+                        spdlog::error("request#{} does not fit in the KV cache of any channel",
+                                      request->id);
+                        ast(0);
+                    }
+                    continue;
+                }
+                ch = request->channel;
+                _ch_predicted_latencys[ch] += predict_mha_latency(request);
+            }
+            if (kv_rows_to_admit(request) > alloc->num_free_rows(ch)) {
+                if (_active_request_queues[ch].empty()) {
+                    spdlog::error("request#{} does not fit in the KV cache of channel {}",
+                                  request->id, ch);
+                    ast(0);
+                }
+                continue;
+            }
             _active_reqs++;
             // spdlog::info("Scheduler allocate request#{}(seq_len:{}) to channel {}<<",
             //              request->id, seq_len, ch);
-            auto k = std::make_shared<PIMTensor>(
-                name_gen(std::to_string(request->id), "KEY", std::to_string(0)), ch, dim_key,
-                PIMTensorKVType::KEY, true);
-            auto v = std::make_shared<PIMTensor>(
-                name_gen(std::to_string(request->id), "VALUE", std::to_string(0)), ch, dim_value,
-                PIMTensorKVType::VALUE, true);
-            request->K_cache.push_back(k);
-            request->V_cache.push_back(v);
+            if (prefix_cached(request)) {
+                _prefix_hits++;
+                _prefill_tokens_saved += request->prefix_len;
+            }
+            for (uint32_t layer = 0; layer < kv_layers(); layer++) {
+                auto k = std::make_shared<PIMTensor>(
+                    name_gen(std::to_string(request->id), "KEY", std::to_string(layer)), ch,
+                    dim_key, PIMTensorKVType::KEY, true,
+                    acquire_prefix_rows(request, layer, PIMTensorKVType::KEY));
+                auto v = std::make_shared<PIMTensor>(
+                    name_gen(std::to_string(request->id), "VALUE", std::to_string(layer)), ch,
+                    dim_value, PIMTensorKVType::VALUE, true,
+                    acquire_prefix_rows(request, layer, PIMTensorKVType::VALUE));
+                request->K_cache.push_back(k);
+                request->V_cache.push_back(v);
+            }
 
             _active_request_queues[ch].push_back(request);
             uint32_t mha_latency = estimate_mha_latency(request);
@@ -217,6 +295,7 @@ void Scheduler::allocate_requests() {
             _active_request_accum_latencys[ch] += mha_latency;
 
             request->is_initiated = true;
+            _joined_reqs++;
         }
 
         batch_size++;
@@ -242,32 +321,172 @@ void Scheduler::allocate_requests() {
 }
 
 void Scheduler::make_program() {
-    std::shared_ptr<BatchedRequest> sub_batch_on_sa;
-    std::shared_ptr<BatchedRequest> sub_batch_on_pim;
-    if (static_cast<int>(_stage) % 2 == 0) {
-        sub_batch_on_sa = std::make_shared<BatchedRequest>(_breq1);
-        sub_batch_on_pim = std::make_shared<BatchedRequest>(_breq2);
-    } else {
-        sub_batch_on_sa = std::make_shared<BatchedRequest>(_breq2);
-        sub_batch_on_pim = std::make_shared<BatchedRequest>(_breq1);
+    _stage_start_cycle = _cycles;
+    if (dynamic_schedule()) {
+        std::vector<Ptr<InferRequest>> none;
+        auto sub_batch_on_sa =
+            std::make_shared<BatchedRequest>(_sa_sub_batch >= 0 ? _breqs[_sa_sub_batch] : none);
+        auto sub_batch_on_pim =
+            std::make_shared<BatchedRequest>(_pim_sub_batch >= 0 ? _breqs[_pim_sub_batch] : none);
+        StageWork sa_work{}, pim_work{};
+        if (_sa_sub_batch >= 0) sa_work = step_work(_sub_batch_steps[_sa_sub_batch]);
+        if (_pim_sub_batch >= 0) pim_work = step_work(_sub_batch_steps[_pim_sub_batch]);
+        spdlog::info("New Program for SA  (sub-batch#{}, size: {})", _sa_sub_batch + 1,
+                     sub_batch_on_sa->_reqs.size());
+        spdlog::info("New Program for PIM (sub-batch#{}, size: {})", _pim_sub_batch + 1,
+                     sub_batch_on_pim->_reqs.size());
+
+        _model_program1 = std::make_unique<StageProgram>(_model, sub_batch_on_sa, StagePlatform::SA,
+                                                         _stage, sa_work, stage_name());
+        _model_program2 = std::make_unique<StageProgram>(
+            _model, sub_batch_on_pim, StagePlatform::PIM, _stage, pim_work, stage_name());
+        refresh_status1();
+        refresh_status2();
+        return;
     }
 
+    // the PIM works on the sub-batch the SA had in the previous stage
+    uint32_t pim_sub_batch = (_sub_stage + _breqs.size() - 1) % _breqs.size();
+    auto sub_batch_on_sa = std::make_shared<BatchedRequest>(_breqs[_sub_stage]);
+    auto sub_batch_on_pim = std::make_shared<BatchedRequest>(_breqs[pim_sub_batch]);
+
     spdlog::info("New Program for SA  (sub-batch.size: {})", sub_batch_on_sa->_reqs.size());
     spdlog::info("New Program for PIM (sub-batch.size: {})", sub_batch_on_pim->_reqs.size());
 
-    _model_program1 =
-        std::make_unique<StageProgram>(_model, sub_batch_on_sa, StagePlatform::SA, _stage);
-    _model_program2 =
-        std::make_unique<StageProgram>(_model, sub_batch_on_pim, StagePlatform::PIM, _stage);
+    _model_program1 = std::make_unique<StageProgram>(_model, sub_batch_on_sa, StagePlatform::SA,
+                                                     _stage, layer_pair(), _iteration, _sub_stage);
+    _model_program2 = std::make_unique<StageProgram>(_model, sub_batch_on_pim, StagePlatform::PIM,
+                                                     _stage, layer_pair(), _iteration, _sub_stage);
 
     refresh_status1();
     refresh_status2();
 }
 
+std::string Scheduler::stage_name() {
+    if (dynamic_schedule())
+        return stageLayerToString(_stage, _round_layer_pair, _iteration) + "_R" +
+               std::to_string(_round);
+    return stageLayerToString(_stage, layer_pair(), _iteration, _sub_stage);
+}
+
+// SA step k = step / 2 runs Pj/FFNs of pair k (k >= 1, of the last layer after the last pair)
+// and QKVgen of the layer after it (k <= pairs, layer 0 for k = 0). PIM step k runs the MHA of
+// the layer QKVgen k generated.
+StageWork Scheduler::step_work(uint32_t step) {
+    uint32_t num_pairs = _layer_pairs.size();
+    uint32_t last_layer = _config.model_n_layer - 1;
+    bool single = _config.layer_sim_mode == LayerSimMode::SINGLE;
+    uint32_t k = step / 2;
+    uint32_t next_layer = k == 0 ? 0 : k <= num_pairs ? _layer_pairs[k - 1] + 1 : last_layer;
+    if (single) next_layer = 0;
+    if (step % 2 == 1) return StageWork{.mha = true, .mha_layer = next_layer};
+
+    StageWork work{.proj_ffns = k >= 1, .qkv_gen = k <= num_pairs, .next_layer = next_layer};
+    if (!single && k >= 1) work.layer = k <= num_pairs ? _layer_pairs[k - 1] : last_layer;
+    return work;
+}
+
+double Scheduler::sa_step_estimate(uint32_t sub_batch, uint32_t step) {
+    auto gemm = GemmModel::GetInstance();
+    uint32_t rows = _breqs[sub_batch].size();
+    uint32_t E = _config.model_n_embd;
+    uint32_t tp = _config.n_tp;
+    StageWork work = step_work(step);
+    double cycles = 0;
+    if (work.proj_ffns) {
+        cycles += gemm->roofline_cycles(1, rows, E / tp, E);  // projection
+        cycles += gemm->roofline_cycles(1, rows, E, 4 * E / tp);  // fc1
+        cycles += gemm->roofline_cycles(1, rows, 4 * E / tp, E);  // fc2
+    }
+    if (work.qkv_gen) cycles += gemm->roofline_cycles(1, rows, E, 3 * E / tp);
+    return cycles;
+}
+
+// the MHA of a sub-batch lasts as long as its busiest channel
+double Scheduler::pim_step_estimate(uint32_t sub_batch) {
+    std::vector<uint64_t> channel_latencys(_dram_channels, 0);
+    for (auto &request : _breqs[sub_batch])
+        channel_latencys[request->channel] += estimate_mha_latency(request);
+    return *std::max_element(channel_latencys.begin(), channel_latencys.end());
+}
+
+// Pairs keeping both platforms busy come first, then the one whose stage times are closest.
+// Ties, and stages where only one platform has work, go to the sub-batches with more steps left.
+// Plans nothing once every sub-batch is done.
+void Scheduler::plan_stage() {
+    std::vector<int> sa_ready{-1}, pim_ready{-1};
+    for (uint32_t sb = 0; sb < _breqs.size(); sb++) {
+        if (_sub_batch_steps[sb] >= num_steps()) continue;
+        (_sub_batch_steps[sb] % 2 == 0 ? sa_ready : pim_ready).push_back(sb);
+    }
+
+    _sa_sub_batch = _pim_sub_batch = -1;
+    int best_busy = 0;
+    double best_idle = 0;
+    uint32_t best_left = 0;
+    for (int a : sa_ready) {
+        for (int b : pim_ready) {
+            int busy = (a >= 0) + (b >= 0);
+            if (busy == 0) continue;
+            double idle = 0;
+            if (busy == 2) {
+                double sa_cycles = sa_step_estimate(a, _sub_batch_steps[a]) * _sa_cycle_scale;
+                double pim_cycles = pim_step_estimate(b) * _pim_cycle_scale;
+                idle = std::abs(sa_cycles - pim_cycles);
+            }
+            uint32_t left = 0;
+            if (a >= 0) left += num_steps() - _sub_batch_steps[a];
+            if (b >= 0) left += num_steps() - _sub_batch_steps[b];
+            bool better = busy > best_busy ||
+                          (busy == best_busy &&
+                           (idle < best_idle || (idle == best_idle && left > best_left)));
+            if (better) {
+                _sa_sub_batch = a;
+                _pim_sub_batch = b;
+                best_busy = busy;
+                best_idle = idle;
+                best_left = left;
+            }
+        }
+    }
+
+    // label the stage after the step of the SA (of the PIM if the SA is idle) as in the A-F table
+    uint32_t num_pairs = _layer_pairs.size();
+    _round_layer_pair = 0;
+    _round_sa_estimate = _round_pim_estimate = 0;
+    if (_sa_sub_batch >= 0) {
+        uint32_t k = _sub_batch_steps[_sa_sub_batch] / 2;
+        bool first = _sa_sub_batch == 0;
+        if (k == 0) {
+            _stage = _round == 0 ? Stage::A : Stage::B;
+        } else if (k <= num_pairs) {
+            _stage = first ? Stage::C : Stage::D;
+            _round_layer_pair = _layer_pairs[k - 1];
+        } else {
+            _stage = first ? Stage::E : Stage::F;
+        }
+        _round_sa_estimate = sa_step_estimate(_sa_sub_batch, _sub_batch_steps[_sa_sub_batch]);
+    } else if (_pim_sub_batch >= 0) {
+        uint32_t k = _sub_batch_steps[_pim_sub_batch] / 2;
+        if (k == 0) {
+            _stage = Stage::B;
+        } else if (k <= num_pairs) {
+            _stage = Stage::D;
+            _round_layer_pair = _layer_pairs[k - 1];
+        } else {
+            _stage = Stage::E;
+        }
+    }
+    if (_pim_sub_batch >= 0) _round_pim_estimate = pim_step_estimate(_pim_sub_batch);
+}
+
 int Scheduler::estimate_mha_latency(Ptr<InferRequest> request) {
+    return estimate_mha_latency(request->input_size);
+}
+
+int Scheduler::estimate_mha_latency(uint32_t seq_len) {
     // calculate MHA latency with sequence length
     int latency = 0;
-    int seq_len = request->input_size;
 
     // key * query
     int chunks = ceil((double)_effective_e / _dram_page_size);
@@ -284,6 +503,73 @@ int Scheduler::estimate_mha_latency(Ptr<InferRequest> request) {
     return latency;
 }
 
+// averaged over the tokens the request will still generate
+int Scheduler::predict_mha_latency(Ptr<InferRequest> request) {
+    uint32_t remaining = request->output_size - request->generated;
+    return estimate_mha_latency(request->input_size + remaining / 2);
+}
+
+void Scheduler::predict_channel_latencys() {
+    _ch_predicted_latencys.assign(_dram_channels, 0);
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        for (auto &request : _active_request_queues[ch])
+            _ch_predicted_latencys[ch] += predict_mha_latency(request);
+    }
+}
+
+// Greedy: among the channels with free rows for the KV cache of the request, prefer those that
+// also have rows for the tokens it will still generate, then the least predicted MHA latency,
+// then the most free rows. A request with a cached prompt prefix stays with it if it fits.
+// Returns the channel, -1 if no channel has room now.
+int Scheduler::place_request(Ptr<InferRequest> request) {
+    auto alloc = KVCacheAlloc::GetInstance();
+    if (request->prefix_hash != 0) {
+        int shared_ch = alloc->find_shared_channel(request->prefix_hash);
+        request->channel = shared_ch;
+        if (shared_ch >= 0 && kv_rows_to_admit(request) <= alloc->num_free_rows(shared_ch))
+            return shared_ch;
+    }
+
+    uint32_t final_len = request->input_size + request->output_size - request->generated;
+    uint32_t final_rows = (PIMTensor::get_required_rows(PIMTensorKVType::KEY, final_len) +
+                           PIMTensor::get_required_rows(PIMTensorKVType::VALUE, final_len)) *
+                          kv_layers();
+    int best_ch = -1;
+    bool best_fits_growth = false;
+    uint64_t best_free_rows = 0;
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        request->channel = ch;
+        uint64_t free_rows = alloc->num_free_rows(ch);
+        if (kv_rows_to_admit(request) > free_rows) continue;
+
+        bool fits_growth = final_rows <= free_rows;
+        bool better = best_ch < 0 || fits_growth > best_fits_growth;
+        if (!better && fits_growth == best_fits_growth) {
+            uint64_t latency = _ch_predicted_latencys[ch];
+            uint64_t best_latency = _ch_predicted_latencys[best_ch];
+            better = latency < best_latency ||
+                     (latency == best_latency && free_rows > best_free_rows);
+        }
+        if (better) {
+            best_ch = ch;
+            best_fits_growth = fits_growth;
+            best_free_rows = free_rows;
+        }
+    }
+    request->channel = best_ch;
+    return best_ch;
+}
+
+// the PIM attention of a sub-batch lasts as long as its busiest channel
+double Scheduler::channel_imbalance() {
+    uint64_t total = 0, max_latency = 0;
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        total += _active_request_accum_latencys[ch];
+        max_latency = std::max<uint64_t>(max_latency, _active_request_accum_latencys[ch]);
+    }
+    return total > 0 ? (double)max_latency * _dram_channels / total : 0;
+}
+
 void Scheduler::group_sub_batches() {
     if (!_config.sub_batch_mode) {
         //>>>
@@ -292,40 +578,42 @@ void Scheduler::group_sub_batches() {
             auto req_queue = _active_request_queues[ch];
             for (auto it = req_queue.begin(); it != req_queue.end(); it++) {
                 Ptr<InferRequest> request = *it;
-                _breq1.push_back(request);
+                _breqs[0].push_back(request);
             }
         }
         return;
         //<<<
     }
 
-    bool ceil_turn = true;
+    uint32_t num_sub_batches = _breqs.size();
+    uint32_t extra_turn = 0;  // sub-batch taking the first of the leftover requests
     for (int ch = 0; ch < _dram_channels; ch++) {
         auto req_queue = _active_request_queues[ch];
         auto latency_queue = _active_request_latency_queues[ch];
         assert(req_queue.size() == latency_queue.size());
 
-        if (_partition_alg_simple) {
-            size_t sb1_size = req_queue.size() / 2;
-
-            if (req_queue.size() % 2 != 0) {
-                if (ceil_turn)
-                    sb1_size = ceil((double)req_queue.size() / 2);
-                else
-                    sb1_size = floor((double)req_queue.size() / 2);
-
-                ceil_turn = !ceil_turn;
+        if (_config.sub_batch_partition == SubBatchPartition::BALANCED) {
+            std::vector<size_t> sub_batch_sizes;
+            for (auto &breq : _breqs) sub_batch_sizes.push_back(breq.size());
+            auto index_lists = partition_lists_balanced(latency_queue, sub_batch_sizes);
+            for (uint32_t sb = 0; sb < num_sub_batches; sb++) {
+                for (int idx : index_lists[sb]) _breqs[sb].push_back(req_queue[idx]);
             }
-
-            for (int i = 0; i < req_queue.size(); i++) {
-                Ptr<InferRequest> request = req_queue[i];
-                if (i < sb1_size)
-                    _breq1.push_back(request);
-                else
-                    _breq2.push_back(request);
+        } else if (_config.sub_batch_partition == SubBatchPartition::SIMPLE) {
+            // consecutive runs in admission order, the leftover requests of the channels go to
+            // the sub-batches in turn
+            size_t sb_size = req_queue.size() / num_sub_batches;
+            uint32_t leftover = req_queue.size() % num_sub_batches;
+            size_t i = 0;
+            for (uint32_t sb = 0; sb < num_sub_batches; sb++) {
+                bool extra = (sb + num_sub_batches - extra_turn) % num_sub_batches < leftover;
+                for (size_t end = i + sb_size + extra; i < end; i++)
+                    _breqs[sb].push_back(req_queue[i]);
             }
+            extra_turn = (extra_turn + leftover) % num_sub_batches;
 
         } else {
+            ast(num_sub_batches == 2);  // the DP splits in two
             auto index_lists = partition_lists_dp(latency_queue);
             std::vector<int> list1 = index_lists.first;
             std::vector<int> list2 = index_lists.second;
@@ -340,7 +628,7 @@ void Scheduler::group_sub_batches() {
                 int req_id = *it;
                 Ptr<InferRequest> request = req_queue[req_id];
                 sum_list1_latencies += latency_queue[req_id];
-                _breq1.push_back(request);
+                _breqs[0].push_back(request);
                 list1_str += std::to_string(req_id) + ", ";
                 time1_str += std::to_string(latency_queue[req_id]) + ", ";
             }
@@ -348,7 +636,7 @@ void Scheduler::group_sub_batches() {
                 int req_id = *it;
                 Ptr<InferRequest> request = req_queue[req_id];
                 sum_list2_latencies += latency_queue[req_id];
-                _breq2.push_back(request);
+                _breqs[1].push_back(request);
                 list2_str += std::to_string(req_id) + ", ";
                 time2_str += std::to_string(latency_queue[req_id]) + ", ";
             }
@@ -362,18 +650,81 @@ void Scheduler::group_sub_batches() {
         }
     }
 
-    spdlog::info("total batch_size: {}", _breq1.size() + _breq2.size());
+    spdlog::info("total batch_size: {}", num_batched_reqs());
+}
+
+uint32_t Scheduler::num_batched_reqs() {
+    uint32_t num_reqs = 0;
+    for (auto &breq : _breqs) num_reqs += breq.size();
+    return num_reqs;
 }
 
-// Called exactly once
+// Called once per iteration
 void Scheduler::init_batches() {
+    if (_config_pending) {
+        _config = _next_config;
+        _ch_load_balancing = _config.ch_load_balancing;
+        _config_pending = false;
+    }
+    _joined_reqs = 0;
+    _preempted_reqs = 0;
+    _migrated_reqs = 0;
     allocate_requests();
     group_sub_batches();
+
+    uint64_t kv_tokens = 0;
+    std::vector<uint32_t> sub_batches;
+    for (auto &breq : _breqs) {
+        sub_batches.push_back(breq.size());
+        for (auto &request : breq) kv_tokens += request->input_size;
+    }
+    auto alloc = KVCacheAlloc::GetInstance();
+    uint64_t kv_rows = 0;
+    uint64_t max_channel_rows = 0;
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        kv_rows += alloc->num_used_rows(ch);
+        max_channel_rows = std::max(max_channel_rows, alloc->num_used_rows(ch));
+    }
+    _iteration_stat = IterationStat{.iteration = _iteration,
+                                    .start_cycle = _cycles,
+                                    .end_cycle = 0,
+                                    .sub_batches = sub_batches,
+                                    .joined = _joined_reqs,
+                                    .left = 0,
+                                    .preempted = _preempted_reqs,
+                                    .kv_tokens = kv_tokens,
+                                    .kv_rows = kv_rows,
+                                    .kv_occupancy = (double)max_channel_rows / alloc->_rows_per_ch,
+                                    .kv_fragmentation = kv_fragmentation(),
+                                    .mha_imbalance = channel_imbalance(),
+                                    .migrated = _migrated_reqs};
+
+    if (dynamic_schedule()) {
+        _sub_batch_steps.assign(_breqs.size(), 0);
+        for (uint32_t sb = 0; sb < _breqs.size(); sb++) {
+            if (_breqs[sb].empty()) _sub_batch_steps[sb] = num_steps();
+        }
+        _round = 0;
+        plan_stage();
+    }
+}
+
+void Scheduler::finish_iteration(uint32_t left) {
+    _iteration_stat.end_cycle = _cycles;
+    _iteration_stat.left = left;
+    _iteration_stats.push_back(_iteration_stat);
 }
 
 void Scheduler::cycle() {
     bool step_next_stage = _model_program1 == nullptr && _model_program2 == nullptr;
 
+    // requests left over from the last iteration or arrived since start the next one
+    if (step_next_stage && _stage == Stage::Finish && !_request_queue.empty()) {
+        _iteration++;
+        _stage = _init_stage;
+        _sub_stage = first_sub_stage(_stage);
+        _layer_pair_idx = 0;
+    }
     if (step_next_stage && _stage == _init_stage && !_request_queue.empty()) {
         init_batches();
         // exit(-1);
@@ -382,43 +733,61 @@ void Scheduler::cycle() {
     _cycles++;
 
     if (_config.sub_batch_mode) {
-        bool lets_make_program1 = _model_program1 == nullptr && _breq1.size() > 0;
-        bool lets_make_program2 = _model_program2 == nullptr && _breq2.size() > 0;
+        // a sub-batch may run empty once few requests are left between iterations
+        bool exist_request = num_batched_reqs() > 0;
+        bool lets_make_program1 = _model_program1 == nullptr && exist_request;
+        bool lets_make_program2 = _model_program2 == nullptr && exist_request;
 
         if (lets_make_program1 && lets_make_program2) {
             if (_stage == Stage::Finish) {
-                cleanup_sub_batch(_breq1);
-                cleanup_sub_batch(_breq2);
-                _breq1.clear();
-                _breq2.clear();
+                size_t completed = _completed_request_queue.size();
+                for (auto &breq : _breqs) {
+                    cleanup_sub_batch(breq);
+                    breq.clear();
+                }
+                finish_iteration(_completed_request_queue.size() - completed);
                 return;
             } else {
                 std::string red = "\033[1;31m";
                 std::string reset = "\033[0m";
-                spdlog::info("{}----------Stage {}----------{}", red, stageToString(_stage), reset);
+                spdlog::info("{}----------Stage {}----------{}", red, stage_name(), reset);
                 make_program();
             }
         }
     } else {
         bool both_program_none = _model_program1 == nullptr && _model_program2 == nullptr;
-        bool exist_request = _breq2.size() > 0 || _breq1.size() > 0;
+        bool exist_request = num_batched_reqs() > 0;
         if (both_program_none && exist_request) {
             if (_stage == Stage::Finish) {
-                cleanup_sub_batch(_breq1);
-                cleanup_sub_batch(_breq2);
-                _breq1.clear();
-                _breq2.clear();
+                size_t completed = _completed_request_queue.size();
+                for (auto &breq : _breqs) {
+                    cleanup_sub_batch(breq);
+                    breq.clear();
+                }
+                finish_iteration(_completed_request_queue.size() - completed);
                 return;
             } else {
                 std::string red = "\033[1;31m";
                 std::string reset = "\033[0m";
-                spdlog::info("{}----------Stage {}----------{}", red, stageToString(_stage), reset);
+                spdlog::info("{}----------Stage {}----------{}", red, stage_name(), reset);
                 make_program();
             }
         }
     }
 }
 
+cycle_type Scheduler::cycles_to_next_event() {
+    if (_has_stage_changed || !_completed_request_queue.empty()) return 0;
+
+    bool both_program_none = _model_program1 == nullptr && _model_program2 == nullptr;
+    bool stage_idle = _stage == _init_stage || _stage == Stage::Finish;
+    if (both_program_none && stage_idle && !_request_queue.empty()) return 0;
+    if (both_program_none && num_batched_reqs() > 0) return 0;
+    for (auto &queue : _kv_copy_queues)
+        if (!queue.empty()) return 0;
+    return std::numeric_limits<cycle_type>::max();
+}
+
 void Scheduler::add_request(std::shared_ptr<InferRequest> request) {
     _request_queue.push_back(request);
 }
@@ -434,16 +803,24 @@ std::shared_ptr<InferRequest> Scheduler::pop_completed_request() {
 
 Tile& Scheduler::top_tile1(uint32_t core_id) {
     static Tile empty_tile = Tile{.status = Tile::Status::EMPTY};
-    if (_executable_tile_queue1.empty()) {
-        return empty_tile;
-    } else {
-        Tile& tile = _executable_tile_queue1.front();
-        if (tile.status == Tile::Status::BAR) {
+    auto& queue = _executable_tile_queues1[core_id];
+    // pass the barriers whose preceding tiles have finished
+    while (!queue.empty() && queue.front().status == Tile::Status::BAR) {
+        RunningOperationStat& stat = _active_operation_stats[queue.front().operation_id];
+        if (stat.total_tiles - stat.remain_tiles < queue.front().barrier_tiles) {
             return empty_tile;
-        } else {
-            tile.stage_platform = StagePlatform::SA;
-            return tile;
         }
+        stat.launched_tiles++;
+        stat.remain_tiles--;
+        queue.pop_front();
+        fill_tile_queue1(core_id);
+    }
+    if (queue.empty()) {
+        return empty_tile;
+    } else {
+        Tile& tile = queue.front();
+        tile.stage_platform = StagePlatform::SA;
+        return tile;
     }
 }
 
@@ -465,26 +842,17 @@ Tile& Scheduler::top_tile2(uint32_t core_id) {
 // ??: Add base address for each addr in tiles / XXX: < necessary comment?
 // ??: something wrong with functionality. seems it's not a necessary function
 void Scheduler::get_tile1(uint32_t core_id) {
-    if (_executable_tile_queue1.empty()) {
+    auto& queue = _executable_tile_queues1[core_id];
+    if (queue.empty()) {
         return;
     } else {
-        Tile& tile = _executable_tile_queue1.front();
-        if (tile.status == Tile::Status::BAR) {
-            RunningOperationStat stat = _finished_operation_stats[tile.operation_id];
-            if (stat.launched_tiles + stat.remain_tiles == stat.total_tiles) {
-                /* POP only if all lauched tiles are finished */
-                _executable_tile_queue1.pop_front();
-                _finished_operation_stats[tile.operation_id].launched_tiles++;
-                _finished_operation_stats[tile.operation_id].remain_tiles--;
-            }
-            return;
-        } else {
-            _active_operation_stats[tile.operation_id].launched_tiles++;
-            _executable_tile_queue1.pop_front();
-            spdlog::debug("Operation {} Core {} Get Tile at {}", tile.optype, core_id,
-                          *_core_cycle);
-            return;
-        }
+        // barriers are passed by top_tile1
+        Tile& tile = queue.front();
+        _active_operation_stats[tile.operation_id].launched_tiles++;
+        spdlog::debug("Operation {} Core {} Get Tile at {}", tile.optype, core_id, *_core_cycle);
+        queue.pop_front();
+        fill_tile_queue1(core_id);
+        return;
     }
 }
 void Scheduler::get_tile2(uint32_t core_id) {
@@ -499,6 +867,7 @@ void Scheduler::get_tile2(uint32_t core_id) {
                 _executable_tile_queue2.pop_front();
                 _finished_operation_stats[tile.operation_id].launched_tiles++;
                 _finished_operation_stats[tile.operation_id].remain_tiles--;
+                fill_tile_queue(_executable_tile_queue2, _tile_source2);
             }
             return;
         } else {
@@ -506,6 +875,7 @@ void Scheduler::get_tile2(uint32_t core_id) {
             _executable_tile_queue2.pop_front();
             spdlog::debug("Operation {} Core {} Get Tile at {}", tile.optype, core_id,
                           *_core_cycle);
+            fill_tile_queue(_executable_tile_queue2, _tile_source2);
             return;
         }
     }
@@ -568,15 +938,17 @@ void Scheduler::cleanup_sub_batch(std::vector<Ptr<InferRequest>> sub_batch) {
         // iteration done -> update request stat in batch
         request->is_initiated = true;
         request->generated++;
+        request->token_cycles.push_back(_cycles);
 
         // clear child operations of Key/Value tensor
-        request->K_cache[0]->clear_child_nodes();
-        request->V_cache[0]->clear_child_nodes();
+        for (auto &k : request->K_cache) k->clear_child_nodes();
+        for (auto &v : request->V_cache) v->clear_child_nodes();
 
         if (request->output_size == request->generated) {
             assert(request->is_initiated);
             // spdlog::info("Scheduler::return request_id: {}", request->id);
             _completed_request_queue.push(request);
+            free_kv_cache(request);
 
             // when completed, free KV cache
             for (auto itr = _request_queue.begin(); itr != _request_queue.end();) {
@@ -589,8 +961,464 @@ void Scheduler::cleanup_sub_batch(std::vector<Ptr<InferRequest>> sub_batch) {
                     itr++;
                 }
             }
+            remove_active_request(request);
+        } else {
+            // the generated token joins the KV cache of the next iteration (grow_kv_caches)
+            request->input_size++;
+
+            auto &req_queue = _active_request_queues[request->channel];
+            auto idx = std::find(req_queue.begin(), req_queue.end(), request) - req_queue.begin();
+            uint32_t mha_latency = estimate_mha_latency(request);
+            _active_request_accum_latencys[request->channel] +=
+                mha_latency - _active_request_latency_queues[request->channel][idx];
+            _active_request_latency_queues[request->channel][idx] = mha_latency;
+        }
+    }
+}
+
+// single-layer simulation reuses the cache of layer 0
+uint32_t Scheduler::kv_layers() {
+    return _config.layer_sim_mode == LayerSimMode::SINGLE ? 1 : _config.model_n_layer;
+}
+
+uint32_t Scheduler::kv_rows_to_admit(Ptr<InferRequest> request) {
+    uint32_t rows = PIMTensor::get_required_rows(PIMTensorKVType::KEY, request->input_size) +
+                    PIMTensor::get_required_rows(PIMTensorKVType::VALUE, request->input_size);
+    if (prefix_cached(request))
+        rows -= kv_prefix_rows(request, PIMTensorKVType::KEY) +
+                kv_prefix_rows(request, PIMTensorKVType::VALUE);
+    return rows * kv_layers();
+}
+
+// Only full blocks of the prefix are shared. The block holding the end of the prefix is also
+// written by the request's own tokens, so every request keeps a private copy of it.
+uint32_t Scheduler::kv_prefix_rows(Ptr<InferRequest> request, PIMTensorKVType kv_type) {
+    if (request->prefix_hash == 0) return 0;
+    uint32_t prefix_len = request->prefix_len;
+    uint32_t full_blocks_len = prefix_len - prefix_len % PIMTensor::get_tokens_per_alloc(kv_type);
+    return PIMTensor::get_required_rows(kv_type, full_blocks_len);
+}
+
+bool Scheduler::prefix_cached(Ptr<InferRequest> request) {
+    return kv_prefix_rows(request, PIMTensorKVType::KEY) > 0 &&
+           KVCacheAlloc::GetInstance()->has_shared_rows(request->channel, request->prefix_hash, 0);
+}
+
+// shared tensors are numbered 2 * layer + (0: KEY, 1: VALUE)
+std::vector<uint64_t> Scheduler::acquire_prefix_rows(Ptr<InferRequest> request, uint32_t layer,
+                                                     PIMTensorKVType kv_type) {
+    uint32_t rows = kv_prefix_rows(request, kv_type);
+    if (rows == 0) return {};
+
+    auto alloc = KVCacheAlloc::GetInstance();
+    uint32_t tensor = 2 * layer + (kv_type == PIMTensorKVType::VALUE);
+    if (alloc->has_shared_rows(request->channel, request->prefix_hash, tensor)) {
+        _prefix_rows_saved += rows;
+        // copy-on-write of the partially filled prefix block
+        if (request->prefix_len % PIMTensor::get_tokens_per_alloc(kv_type) != 0)
+            _cow_rows += PIMTensor::get_rows_per_alloc(kv_type);
+    }
+    return alloc->acquire_shared_rows(request->channel, request->prefix_hash, tensor, rows);
+}
+
+void Scheduler::release_prefix_rows(Ptr<InferRequest> request) {
+    auto alloc = KVCacheAlloc::GetInstance();
+    for (uint32_t layer = 0; layer < request->K_cache.size(); layer++) {
+        if (kv_prefix_rows(request, PIMTensorKVType::KEY) > 0)
+            alloc->release_shared_rows(request->channel, request->prefix_hash, 2 * layer);
+        if (kv_prefix_rows(request, PIMTensorKVType::VALUE) > 0)
+            alloc->release_shared_rows(request->channel, request->prefix_hash, 2 * layer + 1);
+    }
+}
+
+uint32_t Scheduler::kv_rows_to_grow(Ptr<InferRequest> request) {
+    uint32_t rows = 0;
+    for (auto &cache : {request->K_cache, request->V_cache}) {
+        for (auto &tensor : cache) {
+            auto pim_tensor = std::static_pointer_cast<PIMTensor>(tensor);
+            if (pim_tensor->_seq_len < request->input_size)
+                rows += pim_tensor->get_rows_to_add_token();
+        }
+    }
+    return rows;
+}
+
+// Requests of a channel are served in admission order, when the channel runs out of rows the
+// youngest request is preempted until the older one fits (vLLM-style).
+void Scheduler::grow_kv_caches() {
+    auto alloc = KVCacheAlloc::GetInstance();
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        auto &req_queue = _active_request_queues[ch];
+        for (size_t i = 0; i < req_queue.size(); i++) {
+            Ptr<InferRequest> request = req_queue[i];
+            uint32_t rows = kv_rows_to_grow(request);
+            while (rows > alloc->num_free_rows(ch) && req_queue.size() > i + 1)
+                preempt_request(req_queue.back());
+            if (rows > alloc->num_free_rows(ch)) {
+                preempt_request(request);  // youngest one left
+                break;
+            }
+
+            for (auto &cache : {request->K_cache, request->V_cache}) {
+                for (auto &tensor : cache) {
+                    auto pim_tensor = std::static_pointer_cast<PIMTensor>(tensor);
+                    while (pim_tensor->_seq_len < request->input_size) pim_tensor->add_token();
+                }
+            }
+        }
+    }
+}
+
+void Scheduler::free_kv_cache(Ptr<InferRequest> request) {
+    cancel_kv_migration(request);
+    release_prefix_rows(request);
+    for (auto &k : request->K_cache) std::static_pointer_cast<PIMTensor>(k)->free_rows();
+    for (auto &v : request->V_cache) std::static_pointer_cast<PIMTensor>(v)->free_rows();
+    request->K_cache.clear();
+    request->V_cache.clear();
+}
+
+// The preempted request goes back to waiting and is admitted again in arrival order. SWAP moves
+// its KV cache to the host and back before it can rejoin, RECOMPUTE drops it and prefills again
+// (prefill is not simulated, the recomputed tokens are only counted).
+void Scheduler::preempt_request(Ptr<InferRequest> request) {
+    uint64_t rows = 0;
+    for (auto &k : request->K_cache) rows += std::static_pointer_cast<PIMTensor>(k)->get_num_rows();
+    for (auto &v : request->V_cache) rows += std::static_pointer_cast<PIMTensor>(v)->get_num_rows();
+    free_kv_cache(request);
+    remove_active_request(request);
+    _active_reqs--;
+    request->is_initiated = false;
+
+    if (_config.kv_preemption == KVPreemption::SWAP) {
+        uint64_t bytes = rows * _config.dram_page_size * _dram_banks_per_ch;
+        double bytes_per_cycle =
+            (double)_config.kv_swap_bandwidth_gbps * 1e9 / (_config.core_freq * 1e6);  // Mhz
+        request->swap_ready_cycle = _cycles + ceil(2 * bytes / bytes_per_cycle);  // out + in
+        _swapped_bytes += 2 * bytes;
+    } else {
+        _recomputed_tokens += request->input_size;
+    }
+    _preempted_reqs++;
+    _total_preemptions++;
+    spdlog::info("request#{} preempted on channel {} ({} rows)", request->id, request->channel,
+                 rows);
+}
+
+uint64_t Scheduler::kv_cache_rows(Ptr<InferRequest> request) {
+    uint64_t rows = 0;
+    for (auto &k : request->K_cache) rows += std::static_pointer_cast<PIMTensor>(k)->get_num_rows();
+    for (auto &v : request->V_cache) rows += std::static_pointer_cast<PIMTensor>(v)->get_num_rows();
+    return rows;
+}
+
+// Called at the start of an iteration, after the running requests grew their caches. A channel
+// takes part in one migration at a time, and requests sharing a prompt prefix stay put.
+void Scheduler::migrate_kv_caches() {
+    for (auto it = _kv_migrations.begin(); it != _kv_migrations.end();) {
+        if (switch_kv_cache(*it))
+            it = _kv_migrations.erase(it);
+        else
+            it++;
+    }
+
+    std::vector<bool> busy(_dram_channels, false);
+    for (auto &migration : _kv_migrations) busy[migration.src_ch] = busy[migration.dst_ch] = true;
+    uint64_t total = 0;
+    int hot_ch = -1, cold_ch = -1;
+    for (uint32_t ch = 0; ch < _dram_channels; ch++) {
+        total += _active_request_accum_latencys[ch];
+        if (busy[ch]) continue;
+        uint32_t latency = _active_request_accum_latencys[ch];
+        if (hot_ch < 0 || latency > _active_request_accum_latencys[hot_ch]) hot_ch = ch;
+        if (cold_ch < 0 || latency < _active_request_accum_latencys[cold_ch]) cold_ch = ch;
+    }
+    if (hot_ch < 0 || hot_ch == cold_ch) return;
+    uint32_t hot_latency = _active_request_accum_latencys[hot_ch];
+    uint32_t cold_latency = _active_request_accum_latencys[cold_ch];
+    if ((double)hot_latency * _dram_channels <= _config.kv_migration_threshold * total) return;
+
+    // the request that evens out the two channels best
+    auto alloc = KVCacheAlloc::GetInstance();
+    int best = -1;
+    uint32_t best_peak = hot_latency;
+    auto &req_queue = _active_request_queues[hot_ch];
+    for (size_t i = 0; i < req_queue.size(); i++) {
+        if (kv_prefix_rows(req_queue[i], PIMTensorKVType::KEY) > 0) continue;
+        if (kv_cache_rows(req_queue[i]) > alloc->num_free_rows(cold_ch)) continue;
+        uint32_t latency = _active_request_latency_queues[hot_ch][i];
+        uint32_t peak = std::max(hot_latency - latency, cold_latency + latency);
+        if (peak < best_peak) {
+            best = i;
+            best_peak = peak;
+        }
+    }
+    if (best >= 0) start_kv_migration(req_queue[best], cold_ch);
+}
+
+// The copy reads the rows out of the source channel and writes them into the destination one
+// through the DRAM model, competing with the GEMV and GWRITE traffic of the cores.
+void Scheduler::start_kv_migration(Ptr<InferRequest> request, uint32_t dst_ch) {
+    KVMigration migration{.request = request,
+                          .src_ch = (uint32_t)request->channel,
+                          .dst_ch = dst_ch,
+                          .rows = kv_cache_rows(request)};
+    for (uint32_t layer = 0; layer < request->K_cache.size(); layer++) {
+        auto k = std::static_pointer_cast<PIMTensor>(request->K_cache[layer]);
+        auto v = std::static_pointer_cast<PIMTensor>(request->V_cache[layer]);
+        auto k_copy = std::make_shared<PIMTensor>(k->get_name(), dst_ch, k->get_dims(),
+                                                  PIMTensorKVType::KEY, true);
+        auto v_copy = std::make_shared<PIMTensor>(v->get_name(), dst_ch, v->get_dims(),
+                                                  PIMTensorKVType::VALUE, true);
+        for (auto &pair : {std::make_pair(k, k_copy), std::make_pair(v, v_copy)}) {
+            auto src_rows = pair.first->get_rows();
+            auto dst_rows = pair.second->get_rows();
+            assert(src_rows.size() == dst_rows.size());
+            migration.src_rows.insert(migration.src_rows.end(), src_rows.begin(), src_rows.end());
+            migration.dst_rows.insert(migration.dst_rows.end(), dst_rows.begin(), dst_rows.end());
+        }
+        migration.K_cache.push_back(k_copy);
+        migration.V_cache.push_back(v_copy);
+    }
+
+    migration.bytes = migration.rows * _config.dram_page_size * _dram_banks_per_ch;
+    migration.accesses = migration.src_rows.size() * _config.dram_page_size *
+                         _dram_banks_per_ch / _config.dram_req_size;
+    migration.start_cycle = _cycles;
+    migration.ready_cycle = migration.accesses > 0 ? std::numeric_limits<cycle_type>::max()
+                                                   : _cycles;
+    _kv_migrations.push_back(migration);
+    issue_kv_copy_reads(_kv_migrations.back());
+    spdlog::info("request#{} KV cache migrating from channel {} to channel {} ({} rows)",
+                 request->id, migration.src_ch, dst_ch, migration.rows);
+}
+
+// false until the copy is done and the destination has rows for the tokens added meanwhile
+bool Scheduler::switch_kv_cache(KVMigration &migration) {
+    if (migration.ready_cycle > _cycles) return false;
+
+    Ptr<InferRequest> request = migration.request;
+    uint64_t new_rows = 0;
+    for (uint32_t layer = 0; layer < request->K_cache.size(); layer++) {
+        auto k = std::static_pointer_cast<PIMTensor>(request->K_cache[layer]);
+        auto v = std::static_pointer_cast<PIMTensor>(request->V_cache[layer]);
+        new_rows += k->get_num_rows() + v->get_num_rows() -
+                    std::static_pointer_cast<PIMTensor>(migration.K_cache[layer])->get_num_rows() -
+                    std::static_pointer_cast<PIMTensor>(migration.V_cache[layer])->get_num_rows();
+    }
+    if (new_rows > KVCacheAlloc::GetInstance()->num_free_rows(migration.dst_ch)) return false;
+
+    for (auto &cache : {migration.K_cache, migration.V_cache}) {
+        for (auto &tensor : cache) {
+            auto pim_tensor = std::static_pointer_cast<PIMTensor>(tensor);
+            while (pim_tensor->_seq_len < request->input_size) pim_tensor->add_token();
+        }
+    }
+    for (auto &k : request->K_cache) std::static_pointer_cast<PIMTensor>(k)->free_rows();
+    for (auto &v : request->V_cache) std::static_pointer_cast<PIMTensor>(v)->free_rows();
+    remove_active_request(request);
+
+    request->channel = migration.dst_ch;
+    request->K_cache = migration.K_cache;
+    request->V_cache = migration.V_cache;
+    uint32_t mha_latency = estimate_mha_latency(request);
+    _active_request_queues[migration.dst_ch].push_back(request);
+    _active_request_latency_queues[migration.dst_ch].push_back(mha_latency);
+    _active_request_accum_latencys[migration.dst_ch] += mha_latency;
+
+    migration.rows += new_rows;
+    migration.bytes += new_rows * _config.dram_page_size * _dram_banks_per_ch;
+    migration.switch_cycle = _cycles;
+    _kv_migration_stats.push_back(migration);
+    _migrated_reqs++;
+    return true;
+}
+
+// a request leaving during the copy gives the destination rows back. Its accesses already in
+// the DRAM are dropped when they are answered.
+void Scheduler::cancel_kv_migration(Ptr<InferRequest> request) {
+    for (auto it = _kv_migrations.begin(); it != _kv_migrations.end(); it++) {
+        if (it->request != request) continue;
+        for (auto &k : it->K_cache) std::static_pointer_cast<PIMTensor>(k)->free_rows();
+        for (auto &v : it->V_cache) std::static_pointer_cast<PIMTensor>(v)->free_rows();
+        for (uint32_t ch : {it->src_ch, it->dst_ch}) {
+            auto &queue = _kv_copy_queues[ch];
+            for (auto access = queue.begin(); access != queue.end();) {
+                if (_kv_copy_accesses[*access].request_id != request->id) {
+                    access++;
+                    continue;
+                }
+                _kv_copy_accesses.erase(*access);
+                MemoryAccess::release(*access);
+                access = queue.erase(access);
+            }
+        }
+        _kv_migrations.erase(it);
+        return;
+    }
+}
+
+Scheduler::KVMigration *Scheduler::find_kv_migration(uint32_t request_id) {
+    for (auto &migration : _kv_migrations)
+        if (migration.request->id == request_id) return &migration;
+    return nullptr;
+}
+
+// Access #i copies the burst at column (i / banks) % cols of bank i % banks in row
+// i / (banks * cols), so consecutive accesses spread over the banks of the channel.
+MemoryAccess *Scheduler::make_kv_copy_access(KVMigration &migration, uint64_t index,
+                                             bool write) {
+    uint64_t cols = _config.dram_page_size / _config.dram_req_size;
+    uint64_t row_idx = index / (_dram_banks_per_ch * cols);
+    int bank_idx = index % _dram_banks_per_ch;
+    int col = (index / _dram_banks_per_ch) % cols;
+    int ch = write ? migration.dst_ch : migration.src_ch;
+    int row = write ? migration.dst_rows[row_idx] : migration.src_rows[row_idx];
+
+    MemoryAccess *access = MemoryAccess::create({
+        .id = generate_mem_access_id(),
+        .dram_address = AddressConfig::make_bank_address(ch, bank_idx, row, col),
+        .spad_address = 0,
+        .size = _config.dram_req_size,
+        .req_type = write ? MemoryAccessType::WRITE : MemoryAccessType::READ,
+        .request = true,
+        .core_id = 0,
+        .start_cycle = _cycles,
+        .buffer_id = 0,
+        .parent_tile = nullptr,
+        .stage_platform = StagePlatform::PIM,
+    });
+    _kv_copy_accesses[access] = KVCopyAccess{.request_id = migration.request->id, .index = index};
+    _kv_copy_queues[ch].push_back(access);
+    return access;
+}
+
+void Scheduler::issue_kv_copy_reads(KVMigration &migration) {
+    while (migration.reads_issued < migration.accesses &&
+           migration.reads_issued - migration.writes_done < _dram_banks_per_ch) {
+        make_kv_copy_access(migration, migration.reads_issued, false);
+        migration.reads_issued++;
+    }
+}
+
+void Scheduler::pop_kv_copy_access(uint32_t ch) {
+    MemoryAccess *access = _kv_copy_queues[ch].front();
+    _kv_copy_queues[ch].pop_front();
+    access->dram_enter_cycle = _cycles;
+    KVMigration *migration = find_kv_migration(_kv_copy_accesses[access].request_id);
+    if (migration != nullptr && migration->first_access_cycle > _cycles)
+        migration->first_access_cycle = _cycles;
+}
+
+// the copy access at the head of the queue found the DRAM channel full
+void Scheduler::stall_kv_copy_access(uint32_t ch) {
+    KVMigration *migration =
+        find_kv_migration(_kv_copy_accesses[_kv_copy_queues[ch].front()].request_id);
+    if (migration != nullptr) migration->blocked_cycles++;
+}
+
+// an answered read sends its burst on to the destination channel
+void Scheduler::finish_kv_copy_access(MemoryAccess *access) {
+    KVCopyAccess copy = _kv_copy_accesses[access];
+    _kv_copy_accesses.erase(access);
+    bool write = access->req_type == MemoryAccessType::WRITE;
+    MemoryAccess::release(access);
+
+    KVMigration *migration = find_kv_migration(copy.request_id);
+    if (migration == nullptr) return;  // cancelled
+    if (!write) {
+        make_kv_copy_access(*migration, copy.index, true);
+        return;
+    }
+    migration->writes_done++;
+    if (migration->writes_done == migration->accesses)
+        migration->ready_cycle = _cycles;
+    else
+        issue_kv_copy_reads(*migration);
+}
+
+// a core request answered by a channel that is copying a KV cache
+void Scheduler::count_kv_copy_interference(uint32_t ch) {
+    for (auto &migration : _kv_migrations) {
+        if (migration.ready_cycle <= _cycles || migration.first_access_cycle > _cycles) continue;
+        if (migration.src_ch == ch || migration.dst_ch == ch) migration.shared_accesses++;
+    }
+}
+
+// Copy cycles run from the first copy access entering the DRAM to the last write answered.
+// Those overlapped with iterations hide behind the decoding of the batch. blocked_cycles and
+// shared_accesses measure how much the copy and the cores' requests got in each other's way.
+void Scheduler::log_kv_migrations() {
+    std::string fname = Config::global_config.log_dir + "/_kv_migrations.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "request\tsrc_ch\tdst_ch\trows\tbytes\tstart_cycle\tcopy_cycles\toverlapped_cycles\t"
+             "blocked_cycles\tshared_accesses\tswitch_cycle\n";
+    uint64_t bytes = 0, copy_cycles = 0, overlapped_cycles = 0, blocked_cycles = 0;
+    uint64_t shared_accesses = 0;
+    for (auto &migration : _kv_migration_stats) {
+        cycle_type first = std::min(migration.first_access_cycle, migration.ready_cycle);
+        uint64_t overlapped = 0;
+        for (auto &stat : _iteration_stats) {
+            cycle_type start = std::max(stat.start_cycle, first);
+            cycle_type end = std::min(stat.end_cycle, migration.ready_cycle);
+            if (end > start) overlapped += end - start;
+        }
+        cycle_type cycles = migration.ready_cycle - first;
+        ofile << migration.request->id << "\t" << migration.src_ch << "\t" << migration.dst_ch
+              << "\t" << migration.rows << "\t" << migration.bytes << "\t"
+              << migration.start_cycle << "\t" << cycles << "\t" << overlapped << "\t"
+              << migration.blocked_cycles << "\t" << migration.shared_accesses << "\t"
+              << migration.switch_cycle << "\n";
+        bytes += migration.bytes;
+        copy_cycles += cycles;
+        overlapped_cycles += overlapped;
+        blocked_cycles += migration.blocked_cycles;
+        shared_accesses += migration.shared_accesses;
+    }
+    ofile.close();
+
+    spdlog::info(
+        "KV migrations: {}, bytes: {}, copy cycles: {} ({:.1f}% overlapped), blocked cycles: {}, "
+        "shared accesses: {}",
+        _kv_migration_stats.size(), bytes, copy_cycles,
+        copy_cycles > 0 ? 100.0 * overlapped_cycles / copy_cycles : 0, blocked_cycles,
+        shared_accesses);
+}
+
+// internal fragmentation: rows allocated ahead of the tokens that fill them
+double Scheduler::kv_fragmentation() {
+    double wasted_rows = 0;
+    uint64_t used_rows = 0;
+    for (auto &req_queue : _active_request_queues) {
+        for (auto &request : req_queue) {
+            for (auto &cache : {request->K_cache, request->V_cache}) {
+                for (auto &tensor : cache) {
+                    auto pim_tensor = std::static_pointer_cast<PIMTensor>(tensor);
+                    uint32_t allocated = pim_tensor->get_allocated_seq_len();
+                    if (allocated == 0) continue;
+                    wasted_rows += pim_tensor->get_num_rows() *
+                                   (1 - (double)pim_tensor->_seq_len / allocated);
+                    used_rows += pim_tensor->get_num_rows();
+                }
+            }
         }
     }
+    return used_rows > 0 ? wasted_rows / used_rows : 0;
+}
+
+void Scheduler::remove_active_request(Ptr<InferRequest> request) {
+    auto &req_queue = _active_request_queues[request->channel];
+    auto &latency_queue = _active_request_latency_queues[request->channel];
+    auto it = std::find(req_queue.begin(), req_queue.end(), request);
+    if (it == req_queue.end()) return;
+
+    auto idx = it - req_queue.begin();
+    _active_request_accum_latencys[request->channel] -= latency_queue[idx];
+    req_queue.erase(it);
+    latency_queue.erase(latency_queue.begin() + idx);
 }
 
 void Scheduler::refresh_stage() {
@@ -598,28 +1426,57 @@ void Scheduler::refresh_stage() {
     if (stage_done) {
         std::string red = "\033[1;31m";
         std::string reset = "\033[0m";
-        std::string stage_name = stageToString(_stage);
+        std::string stage_name = this->stage_name();
         spdlog::info("{}------- Stage {} Done -------{}", red, stage_name, reset);
 
         // Update stat
-        _stage_stats.push_back(std::make_pair(stage_name, _cycles));
+        _stage_cycles += _cycles - _stage_start_cycle;
+        _stage_stats.push_back(StageCycleStat{.stage = _stage,
+                                              .layer_pair = dynamic_schedule() ? _round_layer_pair
+                                                                               : layer_pair(),
+                                              .iteration = _iteration,
+                                              .name = stage_name,
+                                              .start_cycle = _stage_start_cycle,
+                                              .end_cycle = _cycles});
 
         _prev_stage = _stage;
+        _prev_stage_name = stage_name;
+
+        _has_stage_changed = true;
+
+        if (dynamic_schedule()) {
+            if (_sa_sub_batch >= 0) _sub_batch_steps[_sa_sub_batch]++;
+            if (_pim_sub_batch >= 0) _sub_batch_steps[_pim_sub_batch]++;
+            _round++;
+            plan_stage();
+            if (_sa_sub_batch < 0 && _pim_sub_batch < 0) _stage = Stage::Finish;
+            return;
+        }
+
+        // B/D/F of the next sub-batch
+        if (_sub_stage > 0 && _sub_stage + 1 < _breqs.size() && !_just_one_stage) {
+            _sub_stage++;
+            return;
+        }
 
         // Update stage
         int stageValue = static_cast<int>(_stage);
         stageValue++;
         _stage = static_cast<Stage>(stageValue);
 
-        _has_stage_changed = true;
+        // C/D repeat for every simulated layer pair
+        if (_stage == Stage::E && ++_layer_pair_idx < _layer_pairs.size()) _stage = Stage::C;
+        if (_stage == Stage::C && _layer_pairs.empty()) _stage = Stage::E;
 
         if (!_config.sub_batch_mode) {
             // >> newton
-            if (_stage == Stage::C) _stage = Stage::E;
+            if (_stage == Stage::C && _config.layer_sim_mode == LayerSimMode::SINGLE)
+                _stage = Stage::E;
             if (_stage == Stage::F) _stage = Stage::Finish;
             // << newton
         }
         if (_just_one_stage) _stage = Stage::Finish;  // force to execute just one stage
+        _sub_stage = first_sub_stage(_stage);
     }
 }
 
@@ -627,6 +1484,10 @@ void Scheduler::finish_program1() {
     spdlog::info("Model finish at {}", *_core_cycle);
     _model_program1->log();
 
+    _sa_busy_cycles += _cycles - _stage_start_cycle;
+    if (dynamic_schedule() && _round_sa_estimate > 0)
+        _sa_cycle_scale = (_cycles - _stage_start_cycle) / _round_sa_estimate;
+
     _model_program1 = nullptr;
     refresh_stage();
 
@@ -638,6 +1499,10 @@ void Scheduler::finish_program2() {
     spdlog::info("Model finish at {}", *_core_cycle);
     _model_program2->log();
 
+    _pim_busy_cycles += _cycles - _stage_start_cycle;
+    if (dynamic_schedule() && _round_pim_estimate > 0)
+        _pim_cycle_scale = (_cycles - _stage_start_cycle) / _round_pim_estimate;
+
     _model_program2 = nullptr;
     refresh_stage();
 
@@ -654,7 +1519,7 @@ void Scheduler::refresh_status1() {
     }
     // initiate operation
     // xxx is count_active_operations() == 0 necessary?
-    if (_model_program1 != nullptr && _executable_tile_queue1.empty()) {
+    if (_model_program1 != nullptr && tile_queues1_empty()) {
         // spdlog::info("executable operation count {}",
         //              _model_program1->get_executable_operations().size());
         auto op = _model_program1->get_executable_operations().front();
@@ -668,22 +1533,25 @@ void Scheduler::refresh_status1() {
             }
         }
 
-        assert(op->get_tiles().size());
-        _executable_tile_queue1 = op->get_tiles();
+        assert(op->num_tiles());
+        _tile_source1 = op;
+        for (uint32_t core_id = 0; core_id < _config.num_cores; core_id++) {
+            fill_tile_queue1(core_id);
+        }
         _active_operation_stats[op->get_id()] = RunningOperationStat{
             .id = op->get_id(),
             .name = op->get_name(),
             // xxx necessary?
             // .launched = true,
             .start_cycle = *_core_cycle,
-            .total_tiles = (uint32_t)_executable_tile_queue1.size(),
-            .remain_tiles = (uint32_t)_executable_tile_queue1.size(),
+            .total_tiles = op->num_tiles(),
+            .remain_tiles = op->num_tiles(),
             .launched_tiles = 0,
         };
     } else {
         // spdlog::info("is model null {} / is executable tile queue empty {} / count active ops
         // {}",
-        //              _model_program1 == nullptr, _executable_tile_queue1.empty(),
+        //              _model_program1 == nullptr, tile_queues1_empty(),
         //              count_active_operations());
         // for (auto& op_stat : _active_operation_stats) {
         //     spdlog::info("op stat currently in is {}", op_stat.second.name);
@@ -713,23 +1581,110 @@ void Scheduler::refresh_status2() {
             }
         }
 
-        assert(op->get_tiles().size());
-        _executable_tile_queue2 = op->get_tiles();
+        assert(op->num_tiles());
+        _tile_source2 = op;
+        fill_tile_queue(_executable_tile_queue2, op);
         _active_operation_stats[op->get_id()] = RunningOperationStat{
             .id = op->get_id(),
             .name = op->get_name(),
             // xxx necessary?
             // .launched = true,
             .start_cycle = *_core_cycle,
-            .total_tiles = (uint32_t)_executable_tile_queue2.size(),
-            .remain_tiles = (uint32_t)_executable_tile_queue2.size(),
+            .total_tiles = op->num_tiles(),
+            .remain_tiles = op->num_tiles(),
             .launched_tiles = 0,
         };
     }
 }
 
+void Scheduler::fill_tile_queue(std::deque<Tile> &queue, Ptr<Operation> op) {
+    while (queue.size() < _config.tile_lookahead && op->has_next_tile()) {
+        queue.push_back(op->next_tile());
+    }
+}
+
+void Scheduler::fill_tile_queue1(uint32_t core_id) {
+    auto &queue = _executable_tile_queues1[core_id];
+    while (queue.size() < _config.tile_lookahead && _tile_source1->has_next_tile(core_id)) {
+        queue.push_back(_tile_source1->next_tile(core_id));
+    }
+}
+
+bool Scheduler::tile_queues1_empty() {
+    for (auto &queue : _executable_tile_queues1) {
+        if (!queue.empty()) return false;
+    }
+    return true;
+}
+
 uint32_t Scheduler::count_active_operations() { return _active_operation_stats.size(); }
 
+// Every sub-batch gets n / k of the channel's requests or one more, the extra ones going to the
+// sub-batches with the fewest requests so far, so the SA GEMMs of the sub-batches stay even.
+// The MHA latencies are spread longest first over the least loaded sub-batches with room (LPT),
+// then swaps between the most and the least loaded sub-batches narrow the gap. O(n^2) per swap
+// round on the requests of one channel.
+std::vector<std::vector<int>> Scheduler::partition_lists_balanced(
+    std::vector<uint32_t> latency_list, std::vector<size_t> sub_batch_sizes) {
+    uint32_t k = sub_batch_sizes.size();
+    uint32_t n = latency_list.size();
+    std::vector<uint32_t> sub_batches(k);
+    std::iota(sub_batches.begin(), sub_batches.end(), 0);
+    std::stable_sort(sub_batches.begin(), sub_batches.end(), [&](uint32_t a, uint32_t b) {
+        return sub_batch_sizes[a] < sub_batch_sizes[b];
+    });
+    std::vector<uint32_t> capacity(k, n / k);
+    for (uint32_t i = 0; i < n % k; i++) capacity[sub_batches[i]]++;
+
+    std::vector<int> requests(n);
+    std::iota(requests.begin(), requests.end(), 0);
+    std::stable_sort(requests.begin(), requests.end(),
+                     [&](int a, int b) { return latency_list[a] > latency_list[b]; });
+    std::vector<std::vector<int>> lists(k);
+    std::vector<uint64_t> sums(k, 0);
+    for (int idx : requests) {
+        int target = -1;
+        for (uint32_t j = 0; j < k; j++) {
+            if (lists[j].size() < capacity[j] && (target < 0 || sums[j] < sums[target]))
+                target = j;
+        }
+        lists[target].push_back(idx);
+        sums[target] += latency_list[idx];
+    }
+
+    // a swap moving d < gap keeps the sizes and strictly lowers the sum of squared loads
+    for (uint32_t round = 0; round < n; round++) {
+        auto minmax = std::minmax_element(sums.begin(), sums.end());
+        uint32_t lo = minmax.first - sums.begin();
+        uint32_t hi = minmax.second - sums.begin();
+        uint64_t gap = sums[hi] - sums[lo];
+        int best_a = -1, best_b = -1;
+        uint64_t best_dist = gap;
+        for (size_t a = 0; a < lists[hi].size(); a++) {
+            for (size_t b = 0; b < lists[lo].size(); b++) {
+                uint32_t la = latency_list[lists[hi][a]];
+                uint32_t lb = latency_list[lists[lo][b]];
+                if (la <= lb || la - lb >= gap) continue;
+                uint64_t dist = std::abs(2 * (int64_t)(la - lb) - (int64_t)gap);
+                if (dist < best_dist) {
+                    best_a = a;
+                    best_b = b;
+                    best_dist = dist;
+                }
+            }
+        }
+        if (best_a < 0) break;
+        uint32_t d = latency_list[lists[hi][best_a]] - latency_list[lists[lo][best_b]];
+        std::swap(lists[hi][best_a], lists[lo][best_b]);
+        sums[hi] -= d;
+        sums[lo] += d;
+    }
+
+    // admission order within a sub-batch
+    for (auto &list : lists) std::sort(list.begin(), list.end());
+    return lists;
+}
+
 std::pair<std::vector<int>, std::vector<int>> Scheduler::partition_lists_simple(
     std::vector<uint32_t> originalVector) {
     size_t midpointIndex = originalVector.size() / 2;
@@ -816,14 +1771,130 @@ std::pair<std::vector<int>, std::vector<int>> Scheduler::partition_lists_dp(
 }
 
 void Scheduler::print_stat() {
-    int prev_cycles = 0;
     for (auto stage_stat : _stage_stats) {
-        auto stage_name = stage_stat.first;
-        auto stage_cycles = stage_stat.second;
-        auto exec_cycles = stage_cycles - prev_cycles;
+        auto stage_name = stage_stat.name;
+        auto exec_cycles = stage_stat.end_cycle - stage_stat.start_cycle;
 
         spdlog::info("Stage {} : {} cycles", stage_name, exec_cycles);
+    }
+    log_layer_estimate();
+    log_iteration_stat();
+    if (_config.kv_migration) log_kv_migrations();
+    if (_stage_cycles > 0)
+        spdlog::info("Platform idle in stages: SA {:.1f}%, PIM {:.1f}%",
+                     100.0 * (1 - (double)_sa_busy_cycles / _stage_cycles),
+                     100.0 * (1 - (double)_pim_busy_cycles / _stage_cycles));
+}
+
+void Scheduler::log_iteration_stat() {
+    // every request in an iteration generates one token, so the iteration time is its TPOT
+    uint64_t tokens = 0;
+    uint64_t token_cycles = 0;
+    std::string fname = Config::global_config.log_dir + "/_iterations.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
+    }
+    ofile << "iteration\tstart_cycle\tcycles\tbatch_size\t";
+    for (uint32_t sb = 0; sb < _breqs.size(); sb++) ofile << "sub_batch" << sb + 1 << "\t";
+    ofile << "joined\tleft\tpreempted\tkv_tokens\tkv_rows\tkv_occupancy\tkv_fragmentation\t"
+             "mha_imbalance\tmigrated\n";
+    double mha_imbalance = 0;
+    for (auto &stat : _iteration_stats) {
+        uint32_t batch_size = 0;
+        for (auto sub_batch : stat.sub_batches) batch_size += sub_batch;
+        cycle_type cycles = stat.end_cycle - stat.start_cycle;
+        tokens += batch_size;
+        token_cycles += cycles * batch_size;
+        ofile << stat.iteration << "\t" << stat.start_cycle << "\t" << cycles << "\t"
+              << batch_size << "\t";
+        for (auto sub_batch : stat.sub_batches) ofile << sub_batch << "\t";
+        ofile << stat.joined << "\t" << stat.left << "\t" << stat.preempted << "\t"
+              << stat.kv_tokens << "\t" << stat.kv_rows << "\t" << stat.kv_occupancy << "\t"
+              << stat.kv_fragmentation << "\t" << stat.mha_imbalance << "\t" << stat.migrated
+              << "\n";
+        mha_imbalance += stat.mha_imbalance;
+    }
+    ofile.close();
+
+    if (_total_preemptions > 0)
+        spdlog::info("KV cache preemptions: {}, swapped bytes: {}, recomputed tokens: {}",
+                     _total_preemptions, _swapped_bytes, _recomputed_tokens);
+    if (_prefix_hits > 0)
+        spdlog::info("KV prefix hits: {}, shared rows saved: {}, copied rows: {}, prefill tokens "
+                     "saved: {}",
+                     _prefix_hits, _prefix_rows_saved, _cow_rows, _prefill_tokens_saved);
+
+    if (tokens == 0) return;
+    spdlog::info("Iterations: {}, generated tokens: {}, avg TPOT: {:.1f} cycles",
+                 _iteration_stats.size(), tokens, (double)token_cycles / tokens);
+    spdlog::info("Channel MHA imbalance (max / mean): {:.3f} on average",
+                 mha_imbalance / _iteration_stats.size());
+}
+
+// Whole-model latency A + B + (C+D)*(N-1) + E + F per iteration from the simulated C/D pairs.
+// Sampled pairs are a stratified sample of the N-1 pairs, the interval is a 95% t-interval
+// with finite population correction.
+void Scheduler::log_layer_estimate() {
+    static const double t_975[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                   2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                   2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+
+    uint64_t simulated_cycles = 0;
+    std::map<uint32_t, uint64_t> fixed_cycles;                       // iteration ->
+    std::map<uint32_t, std::map<uint32_t, uint64_t>> pair_cycles;  // iteration -> pair ->
+    for (auto &stage_stat : _stage_stats) {
+        // idle gaps between iterations are not part of any stage
+        cycle_type exec_cycles = stage_stat.end_cycle - stage_stat.start_cycle;
+        simulated_cycles += exec_cycles;
+        if (stage_stat.stage == Stage::C || stage_stat.stage == Stage::D)
+            pair_cycles[stage_stat.iteration][stage_stat.layer_pair] += exec_cycles;
+        else
+            fixed_cycles[stage_stat.iteration] += exec_cycles;
+    }
+
+    uint32_t n_pairs = _config.model_n_layer > 0 ? _config.model_n_layer - 1 : 0;
+    uint32_t k = _layer_pairs.size();
+    if (pair_cycles.empty()) k = 0;  // newton skips C/D in single mode
+    double total = 0, total_var = 0;
+    for (auto &[iteration, cycles] : fixed_cycles) {
+        auto &pairs = pair_cycles[iteration];
+        double mean = 0, var = 0;
+        for (auto &[pair, pair_cycle] : pairs) mean += pair_cycle;
+        if (!pairs.empty()) mean /= pairs.size();
+        for (auto &[pair, pair_cycle] : pairs) var += (pair_cycle - mean) * (pair_cycle - mean);
+        if (pairs.size() > 1) var /= pairs.size() - 1;
+
+        total += cycles + mean * n_pairs;
+        if (pairs.size() > 1 && pairs.size() < n_pairs) {
+            double fpc = (double)(n_pairs - pairs.size()) / (n_pairs - 1);
+            total_var += var / pairs.size() * fpc * n_pairs * n_pairs;
+        }
+    }
+
+    std::string estimate = "-", ci_low = "-", ci_high = "-";
+    if (k > 0 || n_pairs == 0) {
+        estimate = std::to_string((uint64_t)total);
+        if (k == n_pairs) {
+            ci_low = ci_high = estimate;
+        } else if (k > 1) {
+            double t = k - 1 <= 30 ? t_975[k - 2] : 1.96;
+            double half = t * std::sqrt(total_var);
+            ci_low = std::to_string((uint64_t)std::max(0.0, total - half));
+            ci_high = std::to_string((uint64_t)(total + half));
+        }
+    }
+    spdlog::info("Layers simulated: {} of {} C/D pairs, estimated total {} cycles (95% CI {} - {})",
+                 k, n_pairs, estimate, ci_low, ci_high);
 
-        prev_cycles = stage_cycles;
+    std::string fname = Config::global_config.log_dir + "/_layer_estimate.tsv";
+    std::ofstream ofile(fname);
+    if (!ofile.is_open()) {
+        assert(0);
     }
+    ofile << "n_layer\tsimulated_pairs\tsimulated_cycles\testimated_cycles\tci95_low\tci95_high\n";
+    ofile << _config.model_n_layer << "\t" << k << "\t" << simulated_cycles << "\t" << estimate
+          << "\t" << ci_low << "\t" << ci_high << "\n";
+    ofile.close();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "../Model.h"
 #include "../ModelProgram.h"
 #include "../StageProgram.h"
+#include "../tensor/PIMTensor.h"
 
 class Scheduler {
    public:
@@ -20,9 +21,36 @@ class Scheduler {
 
     void print_stat();
 
+    // event-driven fast-forward: the scheduler has no timed events, it either acts in this
+    // cycle (0) or waits for tiles to finish (max)
+    cycle_type cycles_to_next_event();
+    void fast_forward(cycle_type cycles) { _cycles += cycles; }
+
     bool has_stage_changed() { return _has_stage_changed; }
     Stage get_prev_stage() { return _prev_stage; }
+    std::string get_prev_stage_name() { return _prev_stage_name; }
+    cycle_type get_prev_stage_cycles() {
+        return _stage_stats.back().end_cycle - _stage_stats.back().start_cycle;
+    }
+    Stage get_stage() { return _stage; }
     void reset_has_stage_changed_status() { _has_stage_changed = false; }
+    // checkpoint continuations (see apply_continuation_config): the policies change from the
+    // next iteration on, the running one finishes as planned
+    void set_config(SimulationConfig config) {
+        _next_config = config;
+        _config_pending = true;
+    }
+
+    // KV migration copy traffic, injected into the DRAM next to the cores' requests
+    bool has_kv_copy_access(uint32_t ch) { return !_kv_copy_queues[ch].empty(); }
+    MemoryAccess *top_kv_copy_access(uint32_t ch) { return _kv_copy_queues[ch].front(); }
+    void pop_kv_copy_access(uint32_t ch);
+    void stall_kv_copy_access(uint32_t ch);
+    bool is_kv_copy_access(MemoryAccess *access) {
+        return !_kv_copy_accesses.empty() && _kv_copy_accesses.count(access);
+    }
+    void finish_kv_copy_access(MemoryAccess *access);
+    void count_kv_copy_interference(uint32_t ch);
 
     /* for communicating inference request & response with Client */
     virtual void cycle();
@@ -50,23 +78,33 @@ class Scheduler {
 
     std::unique_ptr<StageProgram> _model_program1;
     std::unique_ptr<StageProgram> _model_program2;
-    std::deque<Tile> _executable_tile_queue1;
+    // lookahead window of the running operations' tiles, refilled as cores take them. SA tiles
+    // are queued per core (tensor parallel, Operation::tile_core), PIM tiles are shared
+    std::vector<std::deque<Tile>> _executable_tile_queues1;
     std::deque<Tile> _executable_tile_queue2;
+    Ptr<Operation> _tile_source1;
+    Ptr<Operation> _tile_source2;
 
     SimulationConfig _config;
+    SimulationConfig _next_config;
+    bool _config_pending = false;
     // xxx necessary?
     robin_hood::unordered_map<uint32_t, RunningOperationStat> _finished_operation_stats;
     robin_hood::unordered_map<uint32_t, RunningOperationStat> _active_operation_stats;
 
     Stage _prev_stage;  // for stat
+    std::string _prev_stage_name;
     bool _has_stage_changed;
 
     virtual void refresh_status1();
     virtual void refresh_status2();
+    void fill_tile_queue(std::deque<Tile> &queue, Ptr<Operation> op);
+    void fill_tile_queue1(uint32_t core_id);
+    bool tile_queues1_empty();
 
     uint32_t count_active_operations();
 
-    uint32_t _cycles;
+    cycle_type _cycles;
     std::deque<std::shared_ptr<InferRequest>> _request_queue;
     std::queue<std::shared_ptr<InferRequest>> _completed_request_queue;
     std::vector<std::vector<Ptr<InferRequest>>> _active_request_queues;
@@ -75,8 +113,10 @@ class Scheduler {
     uint32_t _max_batch_size;
     uint32_t _max_active_reqs;
 
-    std::vector<Ptr<InferRequest>> _breq1;
-    std::vector<Ptr<InferRequest>> _breq2;
+    // sub-batches of the iteration (sub_batches of them in sub_batch_mode, otherwise every
+    // request is in the first of two)
+    std::vector<std::vector<Ptr<InferRequest>>> _breqs;
+    uint32_t num_batched_reqs();
 
     // channel load balancing
     bool _ch_load_balancing;
@@ -101,14 +141,25 @@ class Scheduler {
     void allocate_requests();  // allocate channel & assign kv cache
     void group_sub_batches();  // sub-batch interleaving algorithm
     int estimate_mha_latency(Ptr<InferRequest> request);
+    int estimate_mha_latency(uint32_t seq_len);
+
+    // online channel balancing (online_ch_balancing): a request is placed on a channel whenever
+    // it is admitted without KV rows, i.e. on arrival and after a preemption
+    std::vector<uint64_t> _ch_predicted_latencys;  // of the admitted requests, per channel
+    int predict_mha_latency(Ptr<InferRequest> request);
+    void predict_channel_latencys();
+    int place_request(Ptr<InferRequest> request);
+    double channel_imbalance();
 
     int allocate_pim_tile(uint32_t seq_len);
 
-    bool _partition_alg_simple;
     std::pair<std::vector<int>, std::vector<int>> partition_lists_dp(
         std::vector<uint32_t> latency_list);
     std::pair<std::vector<int>, std::vector<int>> partition_lists_simple(
         std::vector<uint32_t> latency_list);
+    // k = sub_batch_sizes.size() sub-batches, sub_batch_sizes: requests already in each
+    std::vector<std::vector<int>> partition_lists_balanced(std::vector<uint32_t> latency_list,
+                                                           std::vector<size_t> sub_batch_sizes);
 
     void make_program();
 
@@ -117,13 +168,155 @@ class Scheduler {
     void finish_program2();
 
     void cleanup_sub_batch(std::vector<Ptr<InferRequest>> sub_batch);
+    void remove_active_request(Ptr<InferRequest> request);
+
+    // ORCA-style iteration-level scheduling (multi_iteration): after each iteration finished
+    // requests leave, running ones keep their token and waiting ones join the next batches
+    typedef struct {
+        uint32_t iteration;
+        cycle_type start_cycle;
+        cycle_type end_cycle;
+        std::vector<uint32_t> sub_batches;
+        uint32_t joined;
+        uint32_t left;
+        uint32_t preempted;
+        uint64_t kv_tokens;
+        uint64_t kv_rows;        // rows in use at the start of the iteration
+        double kv_occupancy;     // of the fullest channel
+        double kv_fragmentation;  // allocated but unfilled share of the used rows
+        double mha_imbalance;     // estimated MHA latency of the busiest channel over the mean
+        uint32_t migrated;        // requests switched to the channel their KV cache moved to
+    } IterationStat;
+    uint32_t _iteration;
+    uint32_t _joined_reqs;
+    IterationStat _iteration_stat;
+    std::vector<IterationStat> _iteration_stats;
+    void finish_iteration(uint32_t left);
+    void log_iteration_stat();
+
+    // paged KV cache on PIM rows: every request owns its rows (the K/V PIMTensors) until it
+    // leaves, and a running request that cannot grow preempts the youngest of its channel
+    uint32_t _preempted_reqs;
+    uint32_t _total_preemptions;
+    uint64_t _swapped_bytes;
+    uint64_t _recomputed_tokens;
+    uint32_t kv_layers();
+    uint32_t kv_rows_to_admit(Ptr<InferRequest> request);
+    uint32_t kv_rows_to_grow(Ptr<InferRequest> request);
+    void grow_kv_caches();
+    void free_kv_cache(Ptr<InferRequest> request);
+    void preempt_request(Ptr<InferRequest> request);
+    double kv_fragmentation();
+
+    // KV migration (kv_migration): the KV cache of a request on the channel with the highest
+    // estimated MHA latency is copied to the least loaded channel. The request keeps decoding
+    // from its old rows during the copy and switches over at the first iteration after it.
+    typedef struct {
+        Ptr<InferRequest> request = nullptr;
+        uint32_t src_ch = 0;
+        uint32_t dst_ch = 0;
+        std::vector<Ptr<BTensor>> K_cache = {};  // copies on dst_ch
+        std::vector<Ptr<BTensor>> V_cache = {};
+        std::vector<uint64_t> src_rows = {};  // copied row by row, src_rows[i] to dst_rows[i]
+        std::vector<uint64_t> dst_rows = {};
+        uint64_t rows = 0;
+        uint64_t bytes = 0;            // read from src_ch and written to dst_ch
+        uint64_t accesses = 0;         // dram_req_size reads, as many writes
+        uint64_t reads_issued = 0;
+        uint64_t writes_done = 0;
+        uint64_t blocked_cycles = 0;   // a copy access found its DRAM channel full
+        uint64_t shared_accesses = 0;  // core requests answered on src_ch/dst_ch during the copy
+        cycle_type start_cycle = 0;
+        // first read entered the DRAM
+        cycle_type first_access_cycle = std::numeric_limits<cycle_type>::max();
+        cycle_type ready_cycle = 0;  // last write answered
+        cycle_type switch_cycle = 0;
+    } KVMigration;
+    std::vector<KVMigration> _kv_migrations;  // in flight
+    std::vector<KVMigration> _kv_migration_stats;
+    uint32_t _migrated_reqs;
+    uint64_t kv_cache_rows(Ptr<InferRequest> request);
+    void migrate_kv_caches();
+    void start_kv_migration(Ptr<InferRequest> request, uint32_t dst_ch);
+    bool switch_kv_cache(KVMigration &migration);
+    void cancel_kv_migration(Ptr<InferRequest> request);
+    void log_kv_migrations();
+
+    // the copy runs through the DRAM model: reads on src_ch, and a write on dst_ch for every
+    // answered read. At most a bank's worth of accesses per migration is outstanding.
+    typedef struct {
+        uint32_t request_id = 0;
+        uint64_t index = 0;  // access index within the copy
+    } KVCopyAccess;
+    std::vector<std::deque<MemoryAccess *>> _kv_copy_queues;  // per channel, not yet in DRAM
+    robin_hood::unordered_map<MemoryAccess *, KVCopyAccess> _kv_copy_accesses;
+    KVMigration *find_kv_migration(uint32_t request_id);
+    void issue_kv_copy_reads(KVMigration &migration);
+    MemoryAccess *make_kv_copy_access(KVMigration &migration, uint64_t index, bool write);
+
+    // prefix sharing: requests with the same prefix_hash in a channel share the KV rows of their
+    // prompt prefix (KVCacheAlloc::acquire_shared_rows)
+    uint32_t _prefix_hits;
+    uint64_t _prefix_rows_saved;
+    uint64_t _prefill_tokens_saved;
+    uint64_t _cow_rows;
+    uint32_t kv_prefix_rows(Ptr<InferRequest> request, PIMTensorKVType kv_type);
+    bool prefix_cached(Ptr<InferRequest> request);
+    std::vector<uint64_t> acquire_prefix_rows(Ptr<InferRequest> request, uint32_t layer,
+                                              PIMTensorKVType kv_type);
+    void release_prefix_rows(Ptr<InferRequest> request);
 
     uint32_t _active_reqs;
 
     Stage _stage;
+    // B, D and F repeat for every sub-batch after the first: sub-batch #(_sub_stage + 1) is on
+    // the SA and the one before it on the PIM. A, C and E start a round with sub-batch #1 (0).
+    uint32_t _sub_stage;
+    uint32_t first_sub_stage(Stage stage) {
+        return stage == Stage::B || stage == Stage::D || stage == Stage::F;
+    }
+    std::string stage_name();
+
+    // dynamic stage schedule (stage_schedule): every sub-batch runs its steps in order, SA (even)
+    // and PIM (odd) in turn: QKVgen, MHA, Pj/FFNs + QKVgen and MHA per simulated layer pair, and
+    // the last Pj/FFNs. At each stage boundary the SA and the PIM each take a sub-batch whose next
+    // step is theirs, the pair whose estimated stage times are closest. The estimates are the
+    // GEMM roofline and estimate_mha_latency, scaled by the last measured SA and PIM stage.
+    // _stage only labels the stages for the stats.
+    std::vector<uint32_t> _sub_batch_steps;  // steps done
+    int _sa_sub_batch;                       // -1: idle
+    int _pim_sub_batch;
+    uint32_t _round;  // stages of the iteration so far
+    uint32_t _round_layer_pair;
+    double _round_sa_estimate;  // unscaled
+    double _round_pim_estimate;
+    double _sa_cycle_scale;  // measured / estimated
+    double _pim_cycle_scale;
+    bool dynamic_schedule() {
+        return _config.sub_batch_mode && _config.stage_schedule == StageSchedule::DYNAMIC;
+    }
+    uint32_t num_steps() { return 2 * _layer_pairs.size() + 3; }
+    StageWork step_work(uint32_t step);
+    double sa_step_estimate(uint32_t sub_batch, uint32_t step);
+    double pim_step_estimate(uint32_t sub_batch);
+    void plan_stage();
+
+    // platform time in stages, for the idle share
+    cycle_type _stage_start_cycle;
+    uint64_t _stage_cycles;
+    uint64_t _sa_busy_cycles;
+    uint64_t _pim_busy_cycles;
     Stage _init_stage;     // default A, if you want to start from other stage, set it
     bool _just_one_stage;  // default false, if you want to run just one stage, set it
 
+    // C/D stage pairs simulated per iteration (see LayerSimMode), _layer_pairs[_layer_pair_idx]
+    // is the current one
+    std::vector<uint32_t> _layer_pairs;
+    uint32_t _layer_pair_idx;
+    uint32_t layer_pair() {
+        return _layer_pair_idx < _layer_pairs.size() ? _layer_pairs[_layer_pair_idx] : 0;
+    }
+
     uint32_t _total_tiles;
     uint32_t _total_available_tiles;
     std::vector<uint32_t> _available_tiles;
@@ -142,7 +335,20 @@ class Scheduler {
     //
     // number of layers (variable): N
     // Total execution time: A + B + (C+D)*(N-1) + E + F
+    // With S sub_batches, B/D/F are S-1 stages each: B2 runs QKVgen#3 on SA and MHA#2 on PIM,
+    // and so on, so every sub-batch alternates between the SA and the PIM
+    // LayerSimMode::FULL runs all N-1 C/D pairs, SAMPLED runs K of them and extrapolates
     //
 
-    std::vector<std::pair<std::string, uint32_t>> _stage_stats;
+    typedef struct {
+        Stage stage;
+        uint32_t layer_pair;
+        uint32_t iteration;
+        std::string name;
+        cycle_type start_cycle;  // make_program() of the stage
+        cycle_type end_cycle;
+    } StageCycleStat;
+    std::vector<StageCycleStat> _stage_stats;
+
+    void log_layer_estimate();
 };
@@ -23,7 +23,7 @@ class BTensor {
     std::vector<Ptr<Operation>> get_child_nodes() { return _child_nodes; }
 
     virtual addr_type get_addr(std::vector<uint32_t> indexes) = 0;
-    virtual std::vector<addr_type> get_all_addrs() = 0;
+    virtual AddrRanges get_all_addrs() = 0;
     virtual void add_token() = 0;
 
     bool _produced;
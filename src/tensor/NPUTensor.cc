@@ -134,14 +134,11 @@ addr_type NPUTensor::get_addr(std::vector<uint32_t> indexes) {
     return _inners[indexes[0]]->get_addr(slice(indexes, 1, -1));
 }
 
-std::vector<addr_type> NPUTensor::get_all_addrs() {
+AddrRanges NPUTensor::get_all_addrs() {
     ast(_inners.size() > 0);
-    std::vector<addr_type> res;
+    AddrRanges res;
     for (int i = 0; i < _inners.size(); i++) {
-        auto addrs = _inners[i]->get_all_addrs();
-        for (auto addr : addrs) {
-            res.push_back(addr);
-        }
+        res.append(_inners[i]->get_all_addrs());
     }
     return res;
 }
@@ -156,7 +153,7 @@ void NPUTensor::add_token() {
 // Used when invoking a 2D tensor by 1D row units in LayerNorm,
 // or when invoking a 3D tensor by 1D row units in Softmax.
 // Should only be used when inner is NPUTensor2D.
-std::vector<addr_type> NPUTensor::get_row_addrs(uint32_t row_idx) {
+AddrRanges NPUTensor::get_row_addrs(uint32_t row_idx) {
     // ast(_inners.size() == 1);
     // ast(_dims.size() == 2);
     if (_dims.size() == 2) {
@@ -16,11 +16,11 @@ class NPUTensor : public BTensor {
     std::vector<uint32_t> get_dims();
 
     virtual addr_type get_addr(std::vector<uint32_t> indexes);
-    virtual std::vector<addr_type> get_all_addrs();
+    virtual AddrRanges get_all_addrs();
     virtual void set_transposed();
     virtual void unset_transposed();
     virtual void add_token() override;  // for KV
-    std::vector<addr_type> get_row_addrs(uint32_t row_idx);
+    AddrRanges get_row_addrs(uint32_t row_idx);
 
     std::vector<Ptr<NPUTensor>> split_by_row(std::vector<uint32_t> row_dims);  // for 2D
 
@@ -26,30 +26,22 @@ addr_type NPUTensor2D::get_addr(std::vector<uint32_t> indexes) {
                                        (indexes[0] * _dims[1] + indexes[1]) * _precision);
 }
 
-std::vector<addr_type> NPUTensor2D::get_all_addrs() {
-    std::vector<addr_type> ret;
-
-    if (_dims.size() == 1) {
-        for (uint32_t i = 0; i < _dims[0]; i++) {
-            ret.push_back(_base_addr + i * _precision);
-        }
-    } else {
-        for (uint32_t i = 0; i < _dims[0]; i++) {
-            for (uint32_t j = 0; j < _dims[1]; j++) {
-                ret.push_back(_base_addr + (i * _dims[1] + j) * _precision);
-            }
-        }
-    }
+AddrRanges NPUTensor2D::get_all_addrs() {
+    AddrRanges ret;
+    uint32_t num_elements = _dims.size() == 1 ? _dims[0] : _dims[0] * _dims[1];
+    ret.push_range(
+        {.base = _base_addr, .stride = 0, .count = 1, .burst = num_elements * _precision});
     return ret;
 }
 
-std::vector<addr_type> NPUTensor2D::get_row_addrs(uint32_t row_idx) {
-    std::vector<addr_type> ret;
+AddrRanges NPUTensor2D::get_row_addrs(uint32_t row_idx) {
+    AddrRanges ret;
     // _dims: [row, column]
     uint32_t col_size = _dims[1];
-    for (uint32_t j = 0; j < col_size; j++) {
-        ret.push_back(_base_addr + (row_idx * col_size + j) * _precision);
-    }
+    ret.push_range({.base = _base_addr + row_idx * col_size * _precision,
+                    .stride = 0,
+                    .count = 1,
+                    .burst = col_size * _precision});
     return ret;
 }
 
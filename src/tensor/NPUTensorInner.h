@@ -12,7 +12,7 @@ class NPUTensorInner {
     NPUTensorInner(std::vector<uint32_t> dims, NPUTensorBufType buf_type)
         : _dims(dims), _buf_type(buf_type), _precision(Config::global_config.precision) {}
     virtual addr_type get_addr(std::vector<uint32_t> indexes) = 0;
-    virtual std::vector<addr_type> get_all_addrs() = 0;
+    virtual AddrRanges get_all_addrs() = 0;
 
     addr_type _base_addr;
     std::vector<uint32_t> _dims;
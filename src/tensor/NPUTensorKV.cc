@@ -44,21 +44,15 @@ addr_type NPUTensorKV::get_addr(std::vector<uint32_t> indexes) {
     return AddressConfig::switch_co_ch(base_addr + offset);
 }
 
-std::vector<addr_type> NPUTensorKV::get_all_addrs() {
-    std::vector<addr_type> ret;
+AddrRanges NPUTensorKV::get_all_addrs() {
+    AddrRanges ret;
     uint32_t d_k = _kv_type == NPUTensorKVType::KEY ? _dims[0] : _dims[1];
 
-    uint32_t cnt = 0;  // counter for (32, d_k)
-    uint32_t idx = 0;  // which pointer is used in _bases
-    for (int i = 0; i < _seq_len * d_k; ++i) {
-        // spdlog::info("i: {}, cnt: {}, idx: {}", i, cnt, idx);
-        ret.push_back(_bases[idx] + cnt * _precision);
-
-        cnt++;
-        if (cnt == _kv_cache_entry_size * d_k) {
-            cnt = 0;
-            idx++;
-        }
+    // one run per (32, d_k) block, the last one holds the remaining tokens
+    for (uint32_t idx = 0; idx * _kv_cache_entry_size < _seq_len; ++idx) {
+        uint32_t tokens = std::min(_kv_cache_entry_size, _seq_len - idx * _kv_cache_entry_size);
+        ret.push_range(
+            {.base = _bases[idx], .stride = 0, .count = 1, .burst = tokens * d_k * _precision});
     }
     return ret;
 }
@@ -9,7 +9,7 @@ class NPUTensorKV : public NPUTensorInner {
     NPUTensorKV() = default;
     NPUTensorKV(std::vector<uint32_t> dims, NPUTensorKVType kv_type);
     virtual addr_type get_addr(std::vector<uint32_t> indexes);
-    virtual std::vector<addr_type> get_all_addrs();
+    virtual AddrRanges get_all_addrs();
     uint32_t get_allocated_seq_len();
     void add_token();  // automatically allocates buffer each time a token is added during iteration
 
@@ -3,7 +3,7 @@
 #include "../allocator/AddressAllocator.h"
 
 PIMTensor::PIMTensor(std::string name, uint32_t ch, std::vector<uint32_t> dims,
-                     PIMTensorKVType kv_type, bool produced) {
+                     PIMTensorKVType kv_type, bool produced, std::vector<uint64_t> shared_rows) {
     _name = name;
     _ch = ch;
     _dims = dims;  // [h, seq_len, d_k] or [h, d_k, seq_len]
@@ -17,29 +17,41 @@ PIMTensor::PIMTensor(std::string name, uint32_t ch, std::vector<uint32_t> dims,
     _num_ele_per_row = alloc->_num_ele_per_row;
     _E = Config::global_config.model_n_embd;
 
-    uint32_t num_alloc_iter = 0;  // calculate # of allocation iterations based on seq_len.
-    if (kv_type == PIMTensorKVType::KEY) {
-        // KEY: allocate (E / C) rows
-        _num_rows_per_alloc = ceil((double)_E / (double)_num_ele_per_row);
-        num_alloc_iter = ceil((double)_seq_len / (double)_bank_per_ch);
-    } else {
-        // VALUE: allocate (E / bank_per_ch) rows
-        _num_rows_per_alloc = ceil((double)_E / (double)_bank_per_ch);
-        num_alloc_iter = ceil((double)_seq_len / (double)_num_ele_per_row);
-    }
+    _num_rows_per_alloc = get_rows_per_alloc(kv_type);
+    uint32_t num_required_alloc = get_required_rows(kv_type, _seq_len);
 
-    uint32_t num_required_alloc = num_alloc_iter * _num_rows_per_alloc;
+    _rows = shared_rows;
+    _num_shared_rows = shared_rows.size();
+    for (int i = _num_shared_rows; i < num_required_alloc; ++i) _rows.push_back(alloc->allocate(ch));
+}
 
-    for (int i = 0; i < num_required_alloc; ++i) _rows.push_back(alloc->allocate(ch));
+uint32_t PIMTensor::get_rows_per_alloc(PIMTensorKVType kv_type) {
+    auto alloc = KVCacheAlloc::GetInstance();
+    uint32_t E = Config::global_config.model_n_embd;
+    if (kv_type == PIMTensorKVType::KEY)
+        return ceil((double)E / (double)alloc->_num_ele_per_row);  // KEY: (E / C) rows
+    else
+        return ceil((double)E / (double)alloc->_bank_per_ch);  // VALUE: (E / bank_per_ch) rows
 }
 
-addr_type PIMTensor::get_addr(std::vector<uint32_t> indexes) { return 0; }
+// tokens stored per allocation of get_rows_per_alloc rows
+uint32_t PIMTensor::get_tokens_per_alloc(PIMTensorKVType kv_type) {
+    auto alloc = KVCacheAlloc::GetInstance();
+    return kv_type == PIMTensorKVType::KEY ? alloc->_bank_per_ch : alloc->_num_ele_per_row;
+}
 
-std::vector<addr_type> PIMTensor::get_all_addrs() {
-    std::vector<addr_type> ret;
-    return ret;
+// rows a cache of seq_len tokens occupies
+uint32_t PIMTensor::get_required_rows(PIMTensorKVType kv_type, uint32_t seq_len) {
+    auto alloc = KVCacheAlloc::GetInstance();
+    // calculate # of allocation iterations based on seq_len.
+    uint32_t num_alloc_iter = ceil((double)seq_len / (double)get_tokens_per_alloc(kv_type));
+    return num_alloc_iter * get_rows_per_alloc(kv_type);
 }
 
+addr_type PIMTensor::get_addr(std::vector<uint32_t> indexes) { return 0; }
+
+AddrRanges PIMTensor::get_all_addrs() { return AddrRanges(); }
+
 uint32_t PIMTensor::get_allocated_seq_len() {
     if (_kv_type == PIMTensorKVType::KEY)
         return ceil((double)_seq_len / (double)_bank_per_ch) * _bank_per_ch;
@@ -64,4 +76,15 @@ uint32_t PIMTensor::get_num_rows() { return _rows.size(); }
 
 uint32_t PIMTensor::get_channel() { return _ch; }
 
-std::vector<uint64_t> PIMTensor::get_rows() { return _rows; }
\ No newline at end of file
+std::vector<uint64_t> PIMTensor::get_rows() { return _rows; }
+
+uint32_t PIMTensor::get_rows_to_add_token() {
+    return _seq_len + 1 > get_allocated_seq_len() ? _num_rows_per_alloc : 0;
+}
+
+void PIMTensor::free_rows() {
+    auto alloc = KVCacheAlloc::GetInstance();
+    for (int i = _num_shared_rows; i < _rows.size(); ++i) alloc->free(_ch, _rows[i]);
+    _rows.clear();
+    _num_shared_rows = 0;
+}
\ No newline at end of file
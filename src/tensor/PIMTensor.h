@@ -7,12 +7,13 @@ enum class PIMTensorKVType { KEY, VALUE };
 class PIMTensor : public BTensor {
    public:
     PIMTensor() = default;
+    // shared_rows: rows of a shared prompt prefix (KVCacheAlloc::acquire_shared_rows)
     PIMTensor(std::string name, uint32_t ch, std::vector<uint32_t> dims, PIMTensorKVType kv_type,
-              bool produced);
+              bool produced, std::vector<uint64_t> shared_rows = {});
     ~PIMTensor() = default;
 
     virtual addr_type get_addr(std::vector<uint32_t> indexes) override;
-    virtual std::vector<addr_type> get_all_addrs() override;
+    virtual AddrRanges get_all_addrs() override;
     virtual void add_token()
         override;  // automatically allocates buffer each time a token is added during iteration.
 
@@ -20,6 +21,12 @@ class PIMTensor : public BTensor {
     uint32_t get_num_rows();
     uint32_t get_channel();
     std::vector<uint64_t> get_rows();
+    uint32_t get_rows_to_add_token();  // rows the next add_token allocates
+    void free_rows();                  // return all private rows to KVCacheAlloc
+
+    static uint32_t get_rows_per_alloc(PIMTensorKVType kv_type);
+    static uint32_t get_tokens_per_alloc(PIMTensorKVType kv_type);
+    static uint32_t get_required_rows(PIMTensorKVType kv_type, uint32_t seq_len);
 
     PIMTensorKVType _kv_type;
     uint32_t _bank_per_ch;
@@ -31,5 +38,6 @@ class PIMTensor : public BTensor {
 
     uint32_t _ch;                 // DRAM channel
     std::vector<uint64_t> _rows;  // store the row index allocated from KVCache.
+    uint32_t _num_shared_rows;    // leading rows of _rows shared with other requests
     uint32_t _seq_len;
 };
\ No newline at end of file
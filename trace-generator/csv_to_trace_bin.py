@@ -0,0 +1,40 @@
+import argparse
+import struct
+
+# binary request trace read by RequestGenerator (src/RequestGenerator.h)
+MAGIC = b"NPTRACE1"
+NAME_SIZE = 32
+
+
+def convert(csv_path, bin_path):
+    with open(csv_path, "r") as fin, open(bin_path, "wb") as fout:
+        columns = fin.readline().strip().split(",")
+        fout.write(MAGIC)
+        fout.write(struct.pack("<II", len(columns), 0))  # n_rows is patched at the end
+        for name in columns:
+            encoded = name.encode()
+            assert len(encoded) <= NAME_SIZE, f"column name too long: {name}"
+            fout.write(encoded.ljust(NAME_SIZE, b"\0"))
+
+        row_format = struct.Struct(f"<{len(columns)}I")
+        n_rows = 0
+        for line in fin:
+            line = line.strip()
+            if not line:
+                continue
+            fout.write(row_format.pack(*map(int, line.split(","))))
+            n_rows += 1
+
+        fout.seek(len(MAGIC) + 4)
+        fout.write(struct.pack("<I", n_rows))
+    return n_rows
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Convert a csv request trace to the binary format")
+    parser.add_argument("csv_path")
+    parser.add_argument("bin_path")
+    args = parser.parse_args()
+
+    n_rows = convert(args.csv_path, args.bin_path)
+    print(f"{n_rows} rows written to {args.bin_path}")